@@ -987,6 +987,35 @@ namespace ELFT
 		std::optional<CBEFFIdentifier> cbeff{};
 	};
 
+	/**
+	 * @brief
+	 * Measurements an implementation makes of its own work during a call.
+	 *
+	 * @details
+	 * Reporting CallMetrics is optional. NIST will log any values
+	 * reported next to its own measurements of the call, which may help
+	 * participants understand where time is spent during validation.
+	 * Values are not used for scoring.
+	 *
+	 * @note
+	 * Added in API version 1.3.0.
+	 */
+	struct CallMetrics
+	{
+		/**
+		 * Time spent in named stages of the call (e.g., "prefilter"),
+		 * in microseconds, in the order the stages ran. Names must
+		 * match the regular expression `[[:alnum:]_]+`.
+		 */
+		std::vector<std::tuple<std::string, uint64_t>> stages{};
+		/**
+		 * Named quantities describing the call (e.g.,
+		 * "candidates_scanned", "bytes_touched", "pruning_ratio").
+		 * Names must match the regular expression `[[:alnum:]_]+`.
+		 */
+		std::vector<std::tuple<std::string, double>> counters{};
+	};
+
 	/** Interface for feature extraction implemented by participant. */
 	class ExtractionInterface
 	{
@@ -1220,6 +1249,32 @@ namespace ELFT
 		    const uint64_t maxSize)
 		    const = 0;
 
+		/**
+		 * @brief
+		 * Obtain measurements of the most recent call to
+		 * createTemplate() or extractTemplateData() made from the
+		 * calling thread.
+		 *
+		 * @return
+		 * Measurements of the call, or no value if none are reported.
+		 *
+		 * @note
+		 * Implementing this method is optional. The default
+		 * implementation reports nothing.
+		 *
+		 * @note
+		 * This method may be called from multiple threads
+		 * simultaneously, each expecting measurements of its own
+		 * most recent call.
+		 *
+		 * @note
+		 * This method shall return instantly.
+		 */
+		virtual
+		std::optional<CallMetrics>
+		getLastCallMetrics()
+		    const;
+
 		/**************************************************************/
 
 		/**
@@ -1451,6 +1506,31 @@ namespace ELFT
 		    const SearchResult &searchResult)
 		    const = 0;
 
+		/**
+		 * @brief
+		 * Obtain measurements of the most recent call to search() or
+		 * extractCorrespondence() made from the calling thread.
+		 *
+		 * @return
+		 * Measurements of the call, or no value if none are reported.
+		 *
+		 * @note
+		 * Implementing this method is optional. The default
+		 * implementation reports nothing.
+		 *
+		 * @note
+		 * This method may be called from multiple threads
+		 * simultaneously, each expecting measurements of its own
+		 * most recent call.
+		 *
+		 * @note
+		 * This method shall return instantly.
+		 */
+		virtual
+		std::optional<CallMetrics>
+		getLastCallMetrics()
+		    const;
+
 		/**************************************************************/
 
 		/**
@@ -1523,9 +1603,9 @@ namespace ELFT
 	/** API major version number. */
 	uint16_t API_MAJOR_VERSION{1};
 	/** API minor version number. */
-	uint16_t API_MINOR_VERSION{2};
+	uint16_t API_MINOR_VERSION{3};
 	/** API patch version number. */
-	uint16_t API_PATCH_VERSION{1};
+	uint16_t API_PATCH_VERSION{0};
 	#endif /* NIST_EXTERN_API_VERSION */
 
 	/*
@@ -0,0 +1,294 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef ELFT_ARCHIVE_H_
+#define ELFT_ARCHIVE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <elft.h>
+
+namespace ELFT
+{
+	/**
+	 * @brief
+	 * Parsed contents of TemplateArchive#manifest.
+	 *
+	 * @details
+	 * The manifest is memory-mapped and parsed in parallel. Entries are
+	 * stored in a single flat table sorted by offset within
+	 * TemplateArchive#archive, and identifiers are stored back to back in
+	 * a single string pool, so that parsing many millions of lines does
+	 * not require an allocation per line.
+	 */
+	class TemplateArchiveManifest
+	{
+	public:
+		/** A single line of the manifest. */
+		struct Entry
+		{
+			/** Offset of identifier within the identifier pool. */
+			uint64_t identifierOffset{};
+			/** Number of bytes in the template. */
+			uint64_t length{};
+			/** Offset of the template within the archive. */
+			uint64_t offset{};
+			/** Number of bytes in the identifier. */
+			uint32_t identifierLength{};
+		};
+
+		/**
+		 * @brief
+		 * TemplateArchiveManifest constructor.
+		 *
+		 * @param manifest
+		 * Path to TemplateArchive#manifest.
+		 * @param numThreads
+		 * Maximum number of threads used to parse `manifest`. 0 will
+		 * use all available hardware threads.
+		 *
+		 * @throw std::runtime_error
+		 * `manifest` could not be read or contains a malformed line.
+		 */
+		TemplateArchiveManifest(
+		    const std::filesystem::path &manifest,
+		    const unsigned int numThreads = 0);
+
+		/**
+		 * @return
+		 * All entries in the manifest, sorted by Entry#offset.
+		 */
+		const std::vector<Entry>&
+		getEntries()
+		    const
+		    noexcept;
+
+		/**
+		 * @brief
+		 * Obtain the identifier of an entry.
+		 *
+		 * @param entry
+		 * Entry from getEntries().
+		 *
+		 * @return
+		 * View of the identifier of `entry`, valid for the lifetime of
+		 * this object.
+		 */
+		std::string_view
+		getIdentifier(
+		    const Entry &entry)
+		    const
+		    noexcept;
+
+		/**
+		 * @return
+		 * Number of entries in the manifest.
+		 */
+		std::size_t
+		size()
+		    const
+		    noexcept;
+
+	private:
+		/** All entries, sorted by Entry#offset. */
+		std::vector<Entry> entries{};
+		/** All identifiers, back to back. */
+		std::string identifiers{};
+	};
+
+	/**
+	 * @brief
+	 * Random and parallel access to the templates in a TemplateArchive.
+	 *
+	 * @details
+	 * TemplateArchive#archive is memory-mapped read-only, and templates
+	 * are returned as views into the mapping, without copying.
+	 */
+	class TemplateArchiveReader
+	{
+	public:
+		/** Non-owning view of a single template in the archive. */
+		struct TemplateView
+		{
+			/** First byte of the template. */
+			const std::byte *data{nullptr};
+			/** Number of bytes in the template. */
+			std::size_t size{};
+		};
+
+		/**
+		 * @brief
+		 * TemplateArchiveReader constructor.
+		 *
+		 * @param archive
+		 * TemplateArchive to read.
+		 * @param numThreads
+		 * Maximum number of threads used to parse the manifest and
+		 * to run forEach(). 0 will use all available hardware
+		 * threads.
+		 *
+		 * @throw std::runtime_error
+		 * Either member of `archive` could not be read, or the
+		 * manifest references bytes beyond the end of the archive.
+		 */
+		TemplateArchiveReader(
+		    const TemplateArchive &archive,
+		    const unsigned int numThreads = 0);
+
+		/**
+		 * @return
+		 * Parsed manifest. Indices passed to other methods are
+		 * indices into TemplateArchiveManifest::getEntries().
+		 */
+		const TemplateArchiveManifest&
+		getManifest()
+		    const
+		    noexcept;
+
+		/**
+		 * @return
+		 * Number of templates in the archive.
+		 */
+		std::size_t
+		size()
+		    const
+		    noexcept;
+
+		/**
+		 * @brief
+		 * Obtain a template by position.
+		 *
+		 * @param index
+		 * Index of the template in manifest order.
+		 *
+		 * @return
+		 * View of the template, valid for the lifetime of this object.
+		 *
+		 * @throw std::out_of_range
+		 * `index` is not less than size().
+		 */
+		TemplateView
+		at(
+		    const std::size_t index)
+		    const;
+
+		/**
+		 * @brief
+		 * Obtain the position of a template by identifier.
+		 *
+		 * @param identifier
+		 * Identifier of the template.
+		 *
+		 * @return
+		 * Index of `identifier` in manifest order, or no value if
+		 * `identifier` is not in the archive.
+		 *
+		 * @note
+		 * The identifier index is built on first use.
+		 */
+		std::optional<std::size_t>
+		find(
+		    const std::string_view identifier)
+		    const;
+
+		/**
+		 * @brief
+		 * Obtain a template by identifier.
+		 *
+		 * @param identifier
+		 * Identifier of the template.
+		 *
+		 * @return
+		 * View of the template, valid for the lifetime of this object,
+		 * or no value if `identifier` is not in the archive.
+		 */
+		std::optional<TemplateView>
+		at(
+		    const std::string_view identifier)
+		    const;
+
+		/**
+		 * @brief
+		 * Call a function on ranges of templates from multiple
+		 * threads.
+		 *
+		 * @param fn
+		 * Function called with a range `[begin, end)` of indices of
+		 * templates that are consecutive in the archive. Called
+		 * concurrently from multiple threads.
+		 *
+		 * @throw
+		 * The first exception thrown by `fn`, after all threads stop.
+		 *
+		 * @note
+		 * Ranges are claimed by idle threads one at a time and the
+		 * archive is read front to back, so storage is accessed
+		 * sequentially regardless of how long `fn` takes.
+		 */
+		void
+		forEachRange(
+		    const std::function<void(const std::size_t begin,
+		        const std::size_t end)> &fn)
+		    const;
+
+		/**
+		 * @brief
+		 * Call a function on every template from multiple threads.
+		 *
+		 * @param fn
+		 * Function called with the index and view of each template.
+		 * Called concurrently from multiple threads.
+		 *
+		 * @throw
+		 * The first exception thrown by `fn`, after all threads stop.
+		 */
+		void
+		forEach(
+		    const std::function<void(const std::size_t index,
+		        const TemplateView &tmpl)> &fn)
+		    const;
+
+		~TemplateArchiveReader();
+
+		/** @cond SUPPRESS_FROM_DOXYGEN */
+		TemplateArchiveReader(const TemplateArchiveReader&) = delete;
+		TemplateArchiveReader& operator=(
+		    const TemplateArchiveReader&) = delete;
+		/** @endcond */
+
+	private:
+		/** Parsed manifest. */
+		const TemplateArchiveManifest manifest;
+		/** Maximum number of threads to use. */
+		const unsigned int numThreads{};
+
+		/** Read-only mapping of the archive. */
+		const std::byte *archive{nullptr};
+		/** Number of bytes mapped at #archive. */
+		std::size_t archiveSize{};
+
+		/** Guards building #identifierIndex. */
+		mutable std::once_flag identifierIndexFlag{};
+		/** Identifier to index in manifest order. */
+		mutable std::unordered_map<std::string_view, std::size_t>
+		    identifierIndex{};
+	};
+}
+
+#endif /* ELFT_ARCHIVE_H_ */
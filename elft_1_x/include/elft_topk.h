@@ -0,0 +1,154 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef ELFT_TOPK_H_
+#define ELFT_TOPK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ELFT
+{
+	/**
+	 * @brief
+	 * Highest similarity scores offered while scanning a database.
+	 *
+	 * @details
+	 * At most getCapacity() entries are kept in a heap whose top is the
+	 * lowest-ranked entry, so offering n scores costs O(n log K) and
+	 * does not allocate. Entries carry an integer key (e.g., the position
+	 * of a reference in the database) instead of a Candidate, so that
+	 * Candidate are only built for the entries that are kept.
+	 *
+	 * Entries are ranked by descending similarity, then by descending
+	 * key. When keys are assigned in Candidate#identifier order, the
+	 * ranked entries are therefore in the order SearchResult#candidateList
+	 * is sorted with `std::greater<Candidate>`.
+	 */
+	class TopKAccumulator
+	{
+	public:
+		/** A single retained score. */
+		struct Entry
+		{
+			/** Quantification of similarity. */
+			double similarity{};
+			/** Caller-defined identifier of what was scored. */
+			uint64_t key{};
+		};
+
+		/**
+		 * @brief
+		 * TopKAccumulator constructor.
+		 *
+		 * @param capacity
+		 * Maximum number of entries to keep (e.g., `maxCandidates`).
+		 */
+		TopKAccumulator(
+		    const std::size_t capacity = 0);
+
+		/**
+		 * @brief
+		 * Discard all entries, reusing storage when possible.
+		 *
+		 * @param capacity
+		 * Maximum number of entries to keep.
+		 */
+		void
+		reset(
+		    const std::size_t capacity);
+
+		/**
+		 * @brief
+		 * Consider a score for inclusion.
+		 *
+		 * @param similarity
+		 * Quantification of similarity.
+		 * @param key
+		 * Caller-defined identifier of what was scored.
+		 *
+		 * @return
+		 * true if the score is kept, false if it ranks below every
+		 * kept entry and no space remains.
+		 */
+		bool
+		offer(
+		    const double similarity,
+		    const uint64_t key);
+
+		/**
+		 * @brief
+		 * Consider every entry kept by another accumulator.
+		 *
+		 * @param other
+		 * Accumulator of scores from another part of the same scan
+		 * (e.g., another thread's shard of the database).
+		 *
+		 * @note
+		 * Because ties are ranked by key, the result does not depend
+		 * on how scores were divided between accumulators.
+		 */
+		void
+		merge(
+		    const TopKAccumulator &other);
+
+		/**
+		 * @return
+		 * Maximum number of entries kept.
+		 */
+		std::size_t
+		getCapacity()
+		    const
+		    noexcept;
+
+		/**
+		 * @return
+		 * Number of entries kept.
+		 */
+		std::size_t
+		size()
+		    const
+		    noexcept;
+
+		/**
+		 * @brief
+		 * Order kept entries from highest to lowest rank.
+		 *
+		 * @return
+		 * Kept entries, best first, valid until the next call to a
+		 * non-const method.
+		 *
+		 * @note
+		 * reset() must be called before offering more scores.
+		 */
+		const std::vector<Entry>&
+		rank()
+		    noexcept;
+
+	private:
+		/**
+		 * @return
+		 * Whether `lhs` ranks before `rhs`.
+		 */
+		static bool
+		ranksBefore(
+		    const Entry &lhs,
+		    const Entry &rhs)
+		    noexcept;
+
+		/** Maximum number of entries kept. */
+		std::size_t capacity{};
+		/** Kept entries, as a heap with the lowest rank on top. */
+		std::vector<Entry> entries{};
+	};
+}
+
+#endif /* ELFT_TOPK_H_ */
@@ -13,6 +13,13 @@
 ELFT::ExtractionInterface::ExtractionInterface() = default;
 ELFT::ExtractionInterface::~ExtractionInterface() = default;
 
+std::optional<ELFT::CallMetrics>
+ELFT::ExtractionInterface::getLastCallMetrics()
+    const
+{
+	return {};
+}
+
 ELFT::ExtractionInterface::SubmissionIdentification::
     SubmissionIdentification() = default;
 ELFT::ExtractionInterface::SubmissionIdentification::SubmissionIdentification(
@@ -31,6 +38,13 @@ ELFT::ExtractionInterface::SubmissionIdentification::SubmissionIdentification(
 ELFT::SearchInterface::SearchInterface() = default;
 ELFT::SearchInterface::~SearchInterface() = default;
 
+std::optional<ELFT::CallMetrics>
+ELFT::SearchInterface::getLastCallMetrics()
+    const
+{
+	return {};
+}
+
 ELFT::Image::Image() = default;
 ELFT::Image::Image(
     const uint8_t identifier,
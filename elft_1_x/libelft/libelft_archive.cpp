@@ -0,0 +1,425 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#include <elft_archive.h>
+
+namespace
+{
+	/** Entries parsed by a single thread. */
+	struct ParsedRange
+	{
+		std::vector<ELFT::TemplateArchiveManifest::Entry> entries{};
+		std::string identifiers{};
+		std::optional<std::string> error{};
+	};
+
+	/**
+	 * @brief
+	 * Parse complete manifest lines.
+	 *
+	 * @param begin
+	 * First character of the first line to parse.
+	 * @param end
+	 * One past the last character of the last line to parse.
+	 * @param range
+	 * Where to store the parsed lines.
+	 */
+	void
+	parseManifestRange(
+	    const char *begin,
+	    const char *end,
+	    ParsedRange &range)
+	{
+		for (const char *line = begin; line < end; ) {
+			auto eol = static_cast<const char*>(std::memchr(line,
+			    '\n', static_cast<std::size_t>(end - line)));
+			if (eol == nullptr)
+				eol = end;
+			if (eol == line) {
+				++line;
+				continue;
+			}
+
+			/* identifier length offset */
+			ELFT::TemplateArchiveManifest::Entry entry{};
+			const auto space = static_cast<const char*>(std::memchr(
+			    line, ' ', static_cast<std::size_t>(eol - line)));
+			bool valid{(space != nullptr) && (space != line)};
+			const char *field{};
+			if (valid) {
+				const auto rv = std::from_chars(space + 1, eol,
+				    entry.length);
+				field = rv.ptr;
+				valid = (rv.ec == std::errc()) && (field != eol) &&
+				    (*field == ' ');
+			}
+			if (valid) {
+				const auto rv = std::from_chars(field + 1, eol,
+				    entry.offset);
+				valid = (rv.ec == std::errc()) && (rv.ptr == eol);
+			}
+			if (!valid) {
+				range.error = "Malformed manifest line: \"" +
+				    std::string(line, eol) + '"';
+				return;
+			}
+
+			entry.identifierOffset = range.identifiers.size();
+			entry.identifierLength = static_cast<uint32_t>(
+			    space - line);
+			range.identifiers.append(line, space);
+			range.entries.push_back(entry);
+
+			line = eol + 1;
+		}
+	}
+}
+
+ELFT::TemplateArchiveManifest::TemplateArchiveManifest(
+    const std::filesystem::path &manifest,
+    const unsigned int numThreads)
+{
+	const int fd{::open(manifest.c_str(), O_RDONLY)};
+	if (fd == -1)
+		throw std::runtime_error{"Could not open " + manifest.string()};
+
+	struct stat sb{};
+	if (::fstat(fd, &sb) != 0) {
+		::close(fd);
+		throw std::runtime_error{"Could not stat " + manifest.string()};
+	}
+	const auto size = static_cast<std::size_t>(sb.st_size);
+	if (size == 0) {
+		::close(fd);
+		return;
+	}
+
+	void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		throw std::runtime_error{"Could not map " + manifest.string()};
+	::madvise(mapping, size, MADV_SEQUENTIAL);
+	const auto *data = static_cast<const char*>(mapping);
+
+	/* Small manifests aren't worth starting threads for */
+	static const std::size_t minBytesPerThread{1024 * 1024};
+	const std::size_t maxThreads{std::max<std::size_t>(1,
+	    (numThreads == 0) ? std::thread::hardware_concurrency() :
+	    numThreads)};
+	const std::size_t threadCount{std::min(maxThreads,
+	    std::max<std::size_t>(1, size / minBytesPerThread))};
+
+	/* Split on line boundaries */
+	std::vector<const char*> boundaries{data};
+	for (std::size_t i{1}; i < threadCount; ++i) {
+		const char *split{std::max(boundaries.back(),
+		    data + ((size / threadCount) * i))};
+		const auto eol = static_cast<const char*>(std::memchr(split,
+		    '\n', static_cast<std::size_t>((data + size) - split)));
+		if (eol == nullptr)
+			break;
+		boundaries.push_back(eol + 1);
+	}
+	boundaries.push_back(data + size);
+
+	std::vector<ParsedRange> ranges(boundaries.size() - 1);
+	if (ranges.size() == 1) {
+		parseManifestRange(boundaries[0], boundaries[1], ranges[0]);
+	} else {
+		std::vector<std::thread> threads{};
+		threads.reserve(ranges.size());
+		for (std::size_t i{}; i < ranges.size(); ++i)
+			threads.emplace_back(parseManifestRange,
+			    boundaries[i], boundaries[i + 1],
+			    std::ref(ranges[i]));
+		for (auto &thread : threads)
+			thread.join();
+	}
+	::munmap(mapping, size);
+
+	/* Combine results from each thread */
+	std::size_t numEntries{}, identifierBytes{};
+	for (const auto &range : ranges) {
+		if (range.error)
+			throw std::runtime_error{*range.error};
+		numEntries += range.entries.size();
+		identifierBytes += range.identifiers.size();
+	}
+	this->entries.reserve(numEntries);
+	this->identifiers.reserve(identifierBytes);
+	for (auto &range : ranges) {
+		const auto base = this->identifiers.size();
+		for (auto &entry : range.entries) {
+			entry.identifierOffset += base;
+			this->entries.push_back(entry);
+		}
+		this->identifiers += range.identifiers;
+
+		range = {};
+	}
+
+	/* Manifests are normally already in offset order */
+	const auto byOffset = [](const Entry &lhs, const Entry &rhs) -> bool {
+		return (lhs.offset < rhs.offset);
+	};
+	if (!std::is_sorted(this->entries.cbegin(), this->entries.cend(),
+	    byOffset))
+		std::stable_sort(this->entries.begin(), this->entries.end(),
+		    byOffset);
+}
+
+const std::vector<ELFT::TemplateArchiveManifest::Entry>&
+ELFT::TemplateArchiveManifest::getEntries()
+    const
+    noexcept
+{
+	return (this->entries);
+}
+
+std::string_view
+ELFT::TemplateArchiveManifest::getIdentifier(
+    const Entry &entry)
+    const
+    noexcept
+{
+	return {this->identifiers.data() + entry.identifierOffset,
+	    entry.identifierLength};
+}
+
+std::size_t
+ELFT::TemplateArchiveManifest::size()
+    const
+    noexcept
+{
+	return (this->entries.size());
+}
+
+/******************************************************************************/
+
+ELFT::TemplateArchiveReader::TemplateArchiveReader(
+    const TemplateArchive &archive,
+    const unsigned int numThreads) :
+    manifest{archive.manifest, numThreads},
+    numThreads{(numThreads == 0) ?
+        std::max(1u, std::thread::hardware_concurrency()) : numThreads}
+{
+	const int fd{::open(archive.archive.c_str(), O_RDONLY)};
+	if (fd == -1)
+		throw std::runtime_error{"Could not open " +
+		    archive.archive.string()};
+
+	struct stat sb{};
+	if (::fstat(fd, &sb) != 0) {
+		::close(fd);
+		throw std::runtime_error{"Could not stat " +
+		    archive.archive.string()};
+	}
+	this->archiveSize = static_cast<std::size_t>(sb.st_size);
+
+	for (const auto &entry : this->manifest.getEntries()) {
+		/* Written to not overflow, since the manifest may be corrupt */
+		if ((entry.length > this->archiveSize) ||
+		    (entry.offset > (this->archiveSize - entry.length))) {
+			::close(fd);
+			throw std::runtime_error{"Manifest entry for " +
+			    std::string(this->manifest.getIdentifier(entry)) +
+			    " is beyond the end of " +
+			    archive.archive.string()};
+		}
+	}
+
+	if (this->archiveSize == 0) {
+		::close(fd);
+		return;
+	}
+
+	void *mapping = ::mmap(nullptr, this->archiveSize, PROT_READ,
+	    MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		throw std::runtime_error{"Could not map " +
+		    archive.archive.string()};
+	this->archive = static_cast<const std::byte*>(mapping);
+}
+
+ELFT::TemplateArchiveReader::~TemplateArchiveReader()
+{
+	if (this->archive != nullptr)
+		::munmap(const_cast<std::byte*>(this->archive),
+		    this->archiveSize);
+}
+
+const ELFT::TemplateArchiveManifest&
+ELFT::TemplateArchiveReader::getManifest()
+    const
+    noexcept
+{
+	return (this->manifest);
+}
+
+std::size_t
+ELFT::TemplateArchiveReader::size()
+    const
+    noexcept
+{
+	return (this->manifest.size());
+}
+
+ELFT::TemplateArchiveReader::TemplateView
+ELFT::TemplateArchiveReader::at(
+    const std::size_t index)
+    const
+{
+	const auto &entry = this->manifest.getEntries().at(index);
+	return {this->archive + entry.offset,
+	    static_cast<std::size_t>(entry.length)};
+}
+
+std::optional<std::size_t>
+ELFT::TemplateArchiveReader::find(
+    const std::string_view identifier)
+    const
+{
+	std::call_once(this->identifierIndexFlag, [this]() {
+		const auto &entries = this->manifest.getEntries();
+		this->identifierIndex.reserve(entries.size());
+		for (std::size_t i{}; i < entries.size(); ++i)
+			this->identifierIndex.emplace(
+			    this->manifest.getIdentifier(entries[i]), i);
+	});
+
+	const auto it = this->identifierIndex.find(identifier);
+	if (it == this->identifierIndex.cend())
+		return {};
+	return (it->second);
+}
+
+std::optional<ELFT::TemplateArchiveReader::TemplateView>
+ELFT::TemplateArchiveReader::at(
+    const std::string_view identifier)
+    const
+{
+	const auto index = this->find(identifier);
+	if (!index)
+		return {};
+	return (this->at(*index));
+}
+
+void
+ELFT::TemplateArchiveReader::forEachRange(
+    const std::function<void(const std::size_t begin,
+        const std::size_t end)> &fn)
+    const
+{
+	const auto &entries = this->manifest.getEntries();
+	if (entries.empty())
+		return;
+
+	/* Group consecutive templates into ranges of a few megabytes */
+	static const uint64_t bytesPerRange{8 * 1024 * 1024};
+	std::vector<std::pair<std::size_t, std::size_t>> ranges{};
+	for (std::size_t begin{}, end{}; begin < entries.size(); begin = end) {
+		const auto start = entries[begin].offset;
+		for (end = begin + 1; end < entries.size(); ++end) {
+			/* Entries were bounded by the archive size and are in
+			 * offset order, so neither operation can wrap */
+			const auto stop = entries[end].offset +
+			    entries[end].length;
+			if ((stop - start) > bytesPerRange)
+				break;
+		}
+		ranges.emplace_back(begin, end);
+	}
+
+	if (this->archive != nullptr)
+		::madvise(const_cast<std::byte*>(this->archive),
+		    this->archiveSize, MADV_SEQUENTIAL);
+
+	/* Idle threads claim the next unprocessed range */
+	std::atomic<std::size_t> nextRange{0};
+	std::atomic<bool> failed{false};
+	std::mutex exceptionMutex{};
+	std::exception_ptr exception{};
+	const auto pageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+	auto worker = [&]() {
+		while (!failed) {
+			const auto r = nextRange.fetch_add(1);
+			if (r >= ranges.size())
+				break;
+
+			/* Ask for this range to be read in all at once */
+			const auto &[begin, end] = ranges[r];
+			if (this->archive != nullptr) {
+				const auto first = reinterpret_cast<uintptr_t>(
+				    this->archive + entries[begin].offset);
+				const auto last = reinterpret_cast<uintptr_t>(
+				    this->archive + entries[end - 1].offset +
+				    entries[end - 1].length);
+				const auto aligned = first & ~(pageSize - 1);
+				::madvise(reinterpret_cast<void*>(aligned),
+				    last - aligned, MADV_WILLNEED);
+			}
+
+			try {
+				fn(begin, end);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock{
+				    exceptionMutex};
+				if (!exception)
+					exception = std::current_exception();
+				failed = true;
+			}
+		}
+	};
+
+	const auto threadCount = std::min<std::size_t>(this->numThreads,
+	    ranges.size());
+	if (threadCount <= 1) {
+		worker();
+	} else {
+		std::vector<std::thread> threads{};
+		threads.reserve(threadCount);
+		for (std::size_t i{}; i < threadCount; ++i)
+			threads.emplace_back(worker);
+		for (auto &thread : threads)
+			thread.join();
+	}
+
+	if (exception)
+		std::rethrow_exception(exception);
+}
+
+void
+ELFT::TemplateArchiveReader::forEach(
+    const std::function<void(const std::size_t index,
+        const TemplateView &tmpl)> &fn)
+    const
+{
+	this->forEachRange([this, &fn](const std::size_t begin,
+	    const std::size_t end) {
+		for (auto i = begin; i < end; ++i)
+			fn(i, this->at(i));
+	});
+}
@@ -0,0 +1,102 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <algorithm>
+
+#include <elft_topk.h>
+
+ELFT::TopKAccumulator::TopKAccumulator(
+    const std::size_t capacity)
+{
+	this->reset(capacity);
+}
+
+void
+ELFT::TopKAccumulator::reset(
+    const std::size_t capacity)
+{
+	this->capacity = capacity;
+	this->entries.clear();
+	this->entries.reserve(capacity);
+}
+
+bool
+ELFT::TopKAccumulator::offer(
+    const double similarity,
+    const uint64_t key)
+{
+	const Entry entry{similarity, key};
+
+	if (this->entries.size() < this->capacity) {
+		this->entries.push_back(entry);
+		std::push_heap(this->entries.begin(), this->entries.end(),
+		    ranksBefore);
+		return (true);
+	}
+
+	/* Full: replace the lowest-ranked entry if this one is better */
+	if (this->entries.empty() ||
+	    !ranksBefore(entry, this->entries.front()))
+		return (false);
+
+	std::pop_heap(this->entries.begin(), this->entries.end(),
+	    ranksBefore);
+	this->entries.back() = entry;
+	std::push_heap(this->entries.begin(), this->entries.end(),
+	    ranksBefore);
+
+	return (true);
+}
+
+void
+ELFT::TopKAccumulator::merge(
+    const TopKAccumulator &other)
+{
+	for (const auto &entry : other.entries)
+		this->offer(entry.similarity, entry.key);
+}
+
+std::size_t
+ELFT::TopKAccumulator::getCapacity()
+    const
+    noexcept
+{
+	return (this->capacity);
+}
+
+std::size_t
+ELFT::TopKAccumulator::size()
+    const
+    noexcept
+{
+	return (this->entries.size());
+}
+
+const std::vector<ELFT::TopKAccumulator::Entry>&
+ELFT::TopKAccumulator::rank()
+    noexcept
+{
+	/* Heap ordered by ranksBefore sorts best first */
+	std::sort_heap(this->entries.begin(), this->entries.end(),
+	    ranksBefore);
+
+	return (this->entries);
+}
+
+bool
+ELFT::TopKAccumulator::ranksBefore(
+    const Entry &lhs,
+    const Entry &rhs)
+    noexcept
+{
+	if (lhs.similarity != rhs.similarity)
+		return (lhs.similarity > rhs.similarity);
+	return (lhs.key > rhs.key);
+}
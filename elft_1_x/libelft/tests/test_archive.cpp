@@ -0,0 +1,179 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <elft.h>
+#include <elft_archive.h>
+
+namespace
+{
+	/** Number of failed checks. */
+	unsigned int failures{};
+
+	/**
+	 * @brief
+	 * Record the outcome of a check.
+	 *
+	 * @param passed
+	 * Whether the check passed.
+	 * @param description
+	 * What was checked.
+	 */
+	void
+	check(
+	    const bool passed,
+	    const char *description)
+	{
+		if (!passed) {
+			std::cerr << "FAIL: " << description << '\n';
+			++failures;
+		}
+	}
+
+	/**
+	 * @brief
+	 * Write a TemplateArchive to disk.
+	 *
+	 * @param directory
+	 * Directory in which to write the archive.
+	 * @param archive
+	 * Contents of the archive file.
+	 * @param manifest
+	 * Contents of the manifest file.
+	 *
+	 * @return
+	 * Paths to the files written.
+	 */
+	ELFT::TemplateArchive
+	writeArchive(
+	    const std::filesystem::path &directory,
+	    const std::string &archive,
+	    const std::string &manifest)
+	{
+		const ELFT::TemplateArchive paths{directory / "archive",
+		    directory / "manifest"};
+		std::ofstream{paths.archive, std::ios_base::binary} << archive;
+		std::ofstream{paths.manifest, std::ios_base::binary} <<
+		    manifest;
+		return (paths);
+	}
+
+	/**
+	 * @return
+	 * Whether constructing a TemplateArchiveReader of `archive` throws
+	 * std::runtime_error.
+	 */
+	bool
+	rejects(
+	    const ELFT::TemplateArchive &archive)
+	{
+		try {
+			const ELFT::TemplateArchiveReader reader{archive};
+		} catch (const std::runtime_error&) {
+			return (true);
+		}
+		return (false);
+	}
+}
+
+int
+main()
+{
+	const auto directory = std::filesystem::temp_directory_path() /
+	    ("test_archive-" + std::to_string(::getpid()));
+	std::filesystem::create_directories(directory);
+
+	/* Well-formed, with a blank line and a failed extraction */
+	try {
+		const ELFT::TemplateArchiveReader reader{writeArchive(directory,
+		    "aaabbbbb", "a 3 0\n\nempty 0 3\nb 5 3\n"), 2};
+		check(reader.size() == 3, "size() counts every entry");
+		check(reader.getManifest().getIdentifier(
+		    reader.getManifest().getEntries()[2]) == "b",
+		    "getIdentifier() returns the identifier");
+
+		const auto b = reader.at("b");
+		check(b && (b->size == 5) && (std::string(reinterpret_cast<
+		    const char*>(b->data), b->size) == "bbbbb"),
+		    "at() views the template bytes");
+		check(reader.at(1).size == 0, "at() of a failure is empty");
+		check(!reader.find("c"), "find() of a missing identifier");
+
+		std::atomic<std::size_t> bytes{};
+		reader.forEach([&bytes](const std::size_t,
+		    const ELFT::TemplateArchiveReader::TemplateView &tmpl) {
+			bytes += tmpl.size;
+		});
+		check(bytes == 8, "forEach() visits every template");
+	} catch (const std::exception &e) {
+		std::cerr << "FAIL: well-formed archive: " << e.what() << '\n';
+		++failures;
+	}
+
+	/* Many lines, split between threads, keep manifest order */
+	std::string archive{}, manifest{};
+	for (unsigned int i{}; i < 10000; ++i) {
+		manifest += std::to_string(i) + " 1 " +
+		    std::to_string(archive.size()) + '\n';
+		archive += static_cast<char>('a' + (i % 26));
+	}
+	try {
+		const ELFT::TemplateArchiveReader reader{writeArchive(directory,
+		    archive, manifest), 8};
+		bool ordered{reader.size() == 10000};
+		for (std::size_t i{}; ordered && (i < reader.size()); ++i)
+			ordered = (reader.getManifest().getIdentifier(
+			    reader.getManifest().getEntries()[i]) ==
+			    std::to_string(i)) &&
+			    (*reinterpret_cast<const char*>(reader.at(i).data) ==
+			    archive[i]);
+		check(ordered, "threaded parse keeps manifest order");
+	} catch (const std::exception &e) {
+		std::cerr << "FAIL: threaded parse: " << e.what() << '\n';
+		++failures;
+	}
+
+	/* Malformed manifests */
+	check(rejects(writeArchive(directory, "aaa", "a 3\n")),
+	    "rejects a missing offset");
+	check(rejects(writeArchive(directory, "aaa", " 3 0\n")),
+	    "rejects a missing identifier");
+	check(rejects(writeArchive(directory, "aaa", "a 3 0 0\n")),
+	    "rejects trailing fields");
+	check(rejects(writeArchive(directory, "aaa", "a -3 0\n")),
+	    "rejects a negative length");
+	check(rejects(writeArchive(directory, "aaa",
+	    "a 3 99999999999999999999\n")), "rejects an unrepresentable "
+	    "offset");
+
+	/* Entries beyond the end of the archive */
+	check(rejects(writeArchive(directory, "aaa", "a 4 0\n")),
+	    "rejects a length beyond the archive");
+	check(rejects(writeArchive(directory, "aaa", "a 1 3\n")),
+	    "rejects an offset beyond the archive");
+	check(rejects(writeArchive(directory, "aaa",
+	    "a 2 18446744073709551615\n")), "rejects an offset that "
+	    "overflows when added to the length");
+
+	std::filesystem::remove_all(directory);
+
+	if (failures != 0)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
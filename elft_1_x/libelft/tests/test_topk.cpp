@@ -0,0 +1,99 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include <elft_topk.h>
+
+namespace
+{
+	/** Number of failed checks. */
+	unsigned int failures{};
+
+	/**
+	 * @brief
+	 * Record the outcome of a check.
+	 *
+	 * @param passed
+	 * Whether the check passed.
+	 * @param description
+	 * What was checked.
+	 */
+	void
+	check(
+	    const bool passed,
+	    const char *description)
+	{
+		if (!passed) {
+			std::cerr << "FAIL: " << description << '\n';
+			++failures;
+		}
+	}
+
+	/**
+	 * @return
+	 * Keys of `entries`, in order.
+	 */
+	std::vector<uint64_t>
+	keys(
+	    const std::vector<ELFT::TopKAccumulator::Entry> &entries)
+	{
+		std::vector<uint64_t> k{};
+		for (const auto &entry : entries)
+			k.push_back(entry.key);
+		return (k);
+	}
+}
+
+int
+main()
+{
+	/* Keeps the highest scores, best first */
+	ELFT::TopKAccumulator topK{3};
+	for (const auto &[similarity, key] : std::vector<std::pair<double,
+	    uint64_t>>{{1, 0}, {5, 1}, {3, 2}, {4, 3}, {2, 4}})
+		topK.offer(similarity, key);
+	check(topK.size() == 3, "size() is capped at capacity");
+	check(keys(topK.rank()) == std::vector<uint64_t>{1, 3, 2},
+	    "rank() orders by descending similarity");
+
+	/* Ties rank by descending key, regardless of offer order */
+	topK.reset(2);
+	check(topK.offer(1, 7), "offer() keeps while space remains");
+	check(topK.offer(1, 9), "offer() keeps while space remains");
+	check(topK.offer(1, 8), "offer() replaces a lower-ranked tie");
+	check(!topK.offer(1, 2), "offer() rejects a lower-ranked tie");
+	check(!topK.offer(0, 100), "offer() rejects a lower score");
+	check(keys(topK.rank()) == std::vector<uint64_t>{9, 8},
+	    "rank() orders ties by descending key");
+
+	/* No capacity keeps nothing */
+	topK.reset(0);
+	check(!topK.offer(1, 1), "offer() with no capacity keeps nothing");
+	check(topK.rank().empty(), "rank() with no capacity is empty");
+
+	/* Merging shards matches a single scan */
+	ELFT::TopKAccumulator whole{4}, first{4}, second{4};
+	for (uint64_t key{}; key < 100; ++key) {
+		const double similarity{static_cast<double>((key * 37) % 11)};
+		whole.offer(similarity, key);
+		(key < 50 ? first : second).offer(similarity, key);
+	}
+	first.merge(second);
+	check(keys(first.rank()) == keys(whole.rank()),
+	    "merge() matches a single accumulator");
+
+	if (failures != 0)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
@@ -8,6 +8,7 @@
  * about its quality, reliability, or any other characteristic.
  */
 
+#include <elft_archive.h>
 #include <elft_nullimpl.h>
 
 ELFT::NullExtractionImplementation::NullExtractionImplementation(
@@ -79,6 +80,16 @@ ELFT::NullExtractionImplementation::createReferenceDatabase(
     const uint64_t maxSize)
     const
 {
+	/*
+	 * Nothing reads the templates, but make sure the manifest parses and
+	 * stays within the archive before copying anything.
+	 */
+	try {
+		const TemplateArchiveReader reader{referenceTemplates};
+	} catch (const std::exception &e) {
+		return {ReturnStatus::Result::Failure, e.what()};
+	}
+
 	try {
 		std::filesystem::copy_file(referenceTemplates.archive,
 		    databaseDirectory / "archive");
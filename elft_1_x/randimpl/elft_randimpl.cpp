@@ -8,13 +8,25 @@
  * about its quality, reliability, or any other characteristic.
  */
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 #include <exception>
 #include <fstream>
-#include <future>
-#include <unordered_map>
+#include <stdexcept>
+#include <thread>
 
+#include <elft_archive.h>
 #include <elft_randimpl.h>
+#include <elft_topk.h>
 
 #ifdef DEBUG
 #include <iostream>
@@ -22,34 +34,6 @@
 #endif /* DEBUG */
 
 
-std::filesystem::path
-ELFT::RandomImplementation::Util::getDirectoryForIdentifier(
-    const std::string &identifier)
-{
-	/*
-	 * We will get bad file system performance if we store millions of
-	 * files in a single directory. To balance this out in this example, we
-	 * will make subdirectories based on the first characters of the
-	 * identifier. If you don't make a database file, you might do something
-	 * similar based on an MD5 checksum of the identifier string.
-	 */
-	static const uint8_t charactersToConsider{8};
-
-	if (identifier.length() <= charactersToConsider)
-		return (identifier);
-
-	return (identifier.substr(0, 2) + '/' + identifier.substr(2, 2) + '/' +
-	    identifier.substr(4, 2) + '/' + identifier.substr(6, 2));
-}
-
-std::filesystem::path
-ELFT::RandomImplementation::Util::getDirectoryForTemplate(
-    const std::vector<std::byte> &templateData)
-{
-	return (getDirectoryForIdentifier(Util::parseTemplate(templateData).
-	    front().candidateIdentifier));
-}
-
 ELFT::RandomImplementation::ConfigurationParameters
 ELFT::RandomImplementation::Util::loadConfiguration(
     const std::filesystem::path &configurationDirectory)
@@ -68,121 +52,404 @@ ELFT::RandomImplementation::Util::loadConfiguration(
 	if (!file)
 		throw std::runtime_error{"Couldn't read from configuration"};
 
+	/* Optional: number of threads, or no value if not configured */
+	const auto readThreads = [&configurationDirectory](
+	    const std::string &fileName) -> std::optional<unsigned int> {
+		const auto threadsPath = configurationDirectory / fileName;
+		if (!std::filesystem::exists(threadsPath))
+			return {};
+
+		unsigned int threads{};
+		std::ifstream threadsFile{threadsPath};
+		threadsFile >> threads;
+		if (!threadsFile || (threads == 0))
+			throw std::runtime_error{"Couldn't read from " +
+			    threadsPath.filename().string()};
+		return (threads);
+	};
+
+	/* Use all threads to build, since nothing else is running */
+	params.buildThreads = readThreads(RandomImplementation::Constants::
+	    buildThreadsConfigFileName).value_or(std::max(1u,
+	    std::thread::hardware_concurrency()));
+
+	/* Search serially by default, since many processes search at once */
+	params.searchThreads = readThreads(RandomImplementation::Constants::
+	    searchThreadsConfigFileName).value_or(1);
+
 	return (params);
 }
 
 std::vector<ELFT::RandomImplementation::Tmpl>
 ELFT::RandomImplementation::Util::parseTemplate(
-    const std::filesystem::path &pathToTemplate)
+    const std::vector<std::byte> &templateData)
 {
-	std::ifstream file{pathToTemplate,
-	    std::ifstream::ate | std::ifstream::binary};
-	if (!file)
-		return {};
-	file.unsetf(std::ifstream::skipws);
-
-	const auto size = file.tellg();
-	if (size == -1)
-		return {};
-
-	std::vector<std::byte> templateData{};
-	templateData.resize(static_cast<std::vector<std::byte>::size_type>(
-	    size));
-	file.seekg(std::ifstream::beg);
-	file.read(reinterpret_cast<char *>(templateData.data()), size);
-
-	return (parseTemplate(templateData));
+	return (parseTemplate(templateData.data(), templateData.size()));
 }
 
 std::vector<ELFT::RandomImplementation::Tmpl>
 ELFT::RandomImplementation::Util::parseTemplate(
-    const std::vector<std::byte> &templateData)
+    const std::byte *templateData,
+    const std::size_t size)
 {
-	std::vector<Tmpl> templates{};
-	auto it = templateData.cbegin();
+	const TmplView view{templateData, size};
 
-	/* First thing in template is string name. Read until null terminator */
-	std::string candidateIdentifier{};
-	while ((it != templateData.cend()) && (static_cast<char>(*it) != '\0'))
-		candidateIdentifier += (static_cast<char>(*it++));
-	++it;
-
-	do {
+	std::vector<Tmpl> templates{};
+	for (const auto &subtemplate : view) {
 		Tmpl t{};
-		t.candidateIdentifier = candidateIdentifier;
-		t.inputIdentifier = static_cast<uint8_t>(*it++);
-		t.frgp = static_cast<FrictionRidgeGeneralizedPosition>(*it++);
-		t.size = static_cast<uint8_t>(*it++);
+		t.candidateIdentifier = view.getIdentifier();
+		t.inputIdentifier = subtemplate.inputIdentifier;
+		t.frgp = subtemplate.frgp;
+		t.size = subtemplate.size;
 		templates.push_back(t);
-		std::advance(it, t.size);
-	} while (it != templateData.cend());
+	}
 
 	return (templates);
 }
 
-std::tuple<ELFT::ReturnStatus, std::vector<std::byte>>
-ELFT::RandomImplementation::Util::readTemplate(
-    const std::filesystem::path &directory,
-    const std::string &identifier)
+bool
+ELFT::RandomImplementation::Util::writeAt(
+    const int fd,
+    const void *data,
+    const std::size_t size,
+    const uint64_t offset)
 {
-	std::ifstream file{directory / identifier,
-	    std::ifstream::ate | std::ifstream::binary};
-	if (!file)
-		return {{ReturnStatus::Result::Failure, "Unable to open "
-		    "template identifier '" + identifier + "'"}, {}};
+	const auto *buf = static_cast<const char*>(data);
+	std::size_t written{};
+	while (written < size) {
+		const auto rv = ::pwrite(fd, buf + written, size - written,
+		    static_cast<off_t>(offset + written));
+		if (rv == -1) {
+			if (errno == EINTR)
+				continue;
+			return (false);
+		}
+		written += static_cast<std::size_t>(rv);
+	}
+
+	return (true);
+}
+
+ELFT::RandomImplementation::TmplView::TmplView(
+    const std::byte *data,
+    const std::size_t size) :
+    last{data + size}
+{
+	/* Subtemplate header: input identifier, FRGP, and size */
+	static constexpr std::size_t headerSize{3};
+
+	const auto *terminator = static_cast<const std::byte*>(
+	    std::memchr(data, '\0', size));
+	if (terminator == nullptr)
+		throw std::runtime_error{"Template identifier is not "
+		    "terminated"};
+	this->identifier = {reinterpret_cast<const char*>(data),
+	    static_cast<std::size_t>(terminator - data)};
+	this->first = terminator + 1;
+
+	if (this->first == this->last)
+		throw std::runtime_error{"Template " +
+		    std::string(this->identifier) + " has no subtemplates"};
+	for (const std::byte *it = this->first; it != this->last; ) {
+		const auto remaining = static_cast<std::size_t>(
+		    this->last - it);
+		if ((remaining < headerSize) || ((remaining - headerSize) <
+		    std::to_integer<std::size_t>(it[2])))
+			throw std::runtime_error{"Subtemplate of " +
+			    std::string(this->identifier) + " is truncated"};
+		it += headerSize + std::to_integer<std::size_t>(it[2]);
+	}
+}
+
+std::string_view
+ELFT::RandomImplementation::TmplView::getIdentifier()
+    const
+    noexcept
+{
+	return (this->identifier);
+}
 
-	file.unsetf(std::ifstream::skipws);
+ELFT::RandomImplementation::TmplView::Iterator
+ELFT::RandomImplementation::TmplView::begin()
+    const
+    noexcept
+{
+	return (Iterator{this->first});
+}
 
-	const auto size = file.tellg();
-	if (size == -1)
-		return {{ReturnStatus::Result::Failure, "Unable to open "
-		    "template identifier '" + identifier + "'"}, {}};
+ELFT::RandomImplementation::TmplView::Iterator
+ELFT::RandomImplementation::TmplView::end()
+    const
+    noexcept
+{
+	return (Iterator{this->last});
+}
 
-	std::vector<std::byte> buf{};
-	buf.resize(static_cast<std::vector<std::byte>::size_type>(size));
-	file.seekg(std::ifstream::beg);
-	file.read(reinterpret_cast<char*>(buf.data()), size);
+ELFT::RandomImplementation::TmplView::Iterator::Iterator(
+    const std::byte *position) :
+    position{position}
+{
 
-	return {{}, buf};
 }
 
-ELFT::ReturnStatus
-ELFT::RandomImplementation::Util::writeTemplate(
-    const std::filesystem::path &directory,
-    const std::vector<std::byte> &templateData,
-    const bool truncate)
-{
-	const auto identifier = Util::parseTemplate(templateData).front().
-	    candidateIdentifier;
-
-	if (!std::filesystem::is_directory(directory)) {
-		if (std::filesystem::exists(directory)) {
-			return {ReturnStatus::Result::Failure,
-			    "Unexpected file at " + directory.string()};
-		}
+ELFT::RandomImplementation::TmplView::Subtemplate
+ELFT::RandomImplementation::TmplView::Iterator::operator*()
+    const
+    noexcept
+{
+	return {std::to_integer<uint8_t>(this->position[0]),
+	    static_cast<FrictionRidgeGeneralizedPosition>(
+	    std::to_integer<uint8_t>(this->position[1])),
+	    this->position + 3, std::to_integer<uint8_t>(this->position[2])};
+}
+
+ELFT::RandomImplementation::TmplView::Iterator&
+ELFT::RandomImplementation::TmplView::Iterator::operator++()
+    noexcept
+{
+	this->position += 3 + std::to_integer<std::size_t>(this->position[2]);
+	return (*this);
+}
+
+bool
+ELFT::RandomImplementation::TmplView::Iterator::operator==(
+    const Iterator &rhs)
+    const
+    noexcept
+{
+	return (this->position == rhs.position);
+}
+
+bool
+ELFT::RandomImplementation::TmplView::Iterator::operator!=(
+    const Iterator &rhs)
+    const
+    noexcept
+{
+	return (!(*this == rhs));
+}
+
+uint64_t
+ELFT::RandomImplementation::Util::deriveSeed(
+    const uint64_t seed,
+    const std::byte *data,
+    const std::size_t size)
+{
+	/* FNV-1a, starting from the seed */
+	uint64_t hash{0xCBF29CE484222325ull ^ seed};
+	for (std::size_t i{}; i < size; ++i) {
+		hash ^= std::to_integer<uint64_t>(data[i]);
+		hash *= 0x100000001B3ull;
+	}
 
-		if (!std::filesystem::create_directories(directory)) {
-			return {ReturnStatus::Result::Failure,
-			    "Could not create directory " +
-			    directory.string()};
+	/* Mix so that similar data does not produce similar seeds */
+	return (mix(hash));
+}
+
+uint64_t
+ELFT::RandomImplementation::Util::deriveSeed(
+    const uint64_t seed,
+    const std::string_view data)
+{
+	return (deriveSeed(seed, reinterpret_cast<const std::byte*>(
+	    data.data()), data.size()));
+}
+
+uint64_t
+ELFT::RandomImplementation::Util::mix(
+    uint64_t x)
+{
+	x ^= (x >> 30);
+	x *= 0xBF58476D1CE4E5B9ull;
+	x ^= (x >> 27);
+	x *= 0x94D049BB133111EBull;
+	x ^= (x >> 31);
+
+	return (x);
+}
+
+ELFT::RandomImplementation::Util::CounterEngine::CounterEngine(
+    const uint64_t key) :
+    key{key}
+{
+
+}
+
+ELFT::RandomImplementation::Util::CounterEngine::result_type
+ELFT::RandomImplementation::Util::CounterEngine::operator()()
+    noexcept
+{
+	/* SplitMix64: scramble the key plus a multiple of the golden ratio */
+	return (mix(this->key + (++this->counter * 0x9E3779B97F4A7C15ull)));
+}
+
+std::vector<ELFT::RandomImplementation::ScanPool*>
+    ELFT::RandomImplementation::ScanPool::pools{};
+std::mutex ELFT::RandomImplementation::ScanPool::poolsMutex{};
+
+ELFT::RandomImplementation::ScanPool::ScanPool(
+    const unsigned int numShards) :
+    numShards{std::max(1u, numShards)}
+{
+	static std::once_flag registerForkHandlers{};
+	std::call_once(registerForkHandlers, []() {
+		if (::pthread_atfork(prepareFork, finishFork,
+		    finishFork) != 0)
+			throw std::runtime_error{"Could not register fork "
+			    "handlers"};
+	});
+
+	/* Hold off fork() until registered, so fork() stops the threads */
+	std::lock_guard lock{poolsMutex};
+	this->threads.reserve(this->numShards - 1);
+	try {
+		this->start();
+	} catch (...) {
+		this->stop();
+		throw;
+	}
+	pools.push_back(this);
+}
+
+unsigned int
+ELFT::RandomImplementation::ScanPool::getNumShards()
+    const
+    noexcept
+{
+	return (this->numShards);
+}
+
+void
+ELFT::RandomImplementation::ScanPool::run(
+    const std::function<void(const unsigned int shard)> &fn)
+{
+	std::lock_guard serialize{this->runMutex};
+
+	/* Nothing to do unless restarting after fork() failed */
+	this->start();
+
+	{
+		std::lock_guard lock{this->mutex};
+		this->task = &fn;
+		this->error = nullptr;
+		this->remaining = this->numShards - 1;
+		++this->generation;
+	}
+	this->changed.notify_all();
+
+	/* Calling thread runs the first shard */
+	std::exception_ptr callerError{};
+	try {
+		fn(0);
+	} catch (...) {
+		callerError = std::current_exception();
+	}
+
+	std::unique_lock lock{this->mutex};
+	this->changed.wait(lock, [this]() { return (this->remaining == 0); });
+	this->task = nullptr;
+
+	if (callerError)
+		std::rethrow_exception(callerError);
+	if (this->error)
+		std::rethrow_exception(this->error);
+}
+
+void
+ELFT::RandomImplementation::ScanPool::start()
+{
+	uint64_t started{};
+	{
+		std::lock_guard lock{this->mutex};
+		started = this->generation;
+	}
+
+	while ((this->threads.size() + 1) < this->numShards) {
+		const auto shard = static_cast<unsigned int>(
+		    this->threads.size() + 1);
+		this->threads.emplace_back(&ScanPool::work, this, shard,
+		    started);
+	}
+}
+
+void
+ELFT::RandomImplementation::ScanPool::stop()
+{
+	{
+		std::lock_guard lock{this->mutex};
+		this->stopping = true;
+	}
+	this->changed.notify_all();
+
+	for (auto &thread : this->threads)
+		thread.join();
+	this->threads.clear();
+	this->stopping = false;
+}
+
+void
+ELFT::RandomImplementation::ScanPool::work(
+    const unsigned int shard,
+    const uint64_t started)
+{
+	uint64_t finished{started};
+
+	std::unique_lock lock{this->mutex};
+	while (true) {
+		this->changed.wait(lock, [this, &finished]() {
+			return (this->stopping ||
+			    (this->generation != finished));
+		});
+		if (this->stopping)
+			return;
+		finished = this->generation;
+
+		const auto *fn = this->task;
+		lock.unlock();
+		std::exception_ptr shardError{};
+		try {
+			(*fn)(shard);
+		} catch (...) {
+			shardError = std::current_exception();
 		}
+		lock.lock();
+
+		if (shardError && !this->error)
+			this->error = shardError;
+		if (--this->remaining == 0)
+			this->changed.notify_all();
 	}
+}
 
-	std::ofstream::openmode mode = std::ofstream::out |
-	    std::ofstream::binary;
-	if (truncate)
-		mode |= std::ofstream::trunc;
-	std::ofstream file{directory / identifier, mode};
-	if (!file)
-		return {ReturnStatus::Result::Failure, "Unable to create "
-		    "template identifier '" + identifier + "'"};
+void
+ELFT::RandomImplementation::ScanPool::prepareFork()
+{
+	/* Waits for searches in progress, and blocks new ones */
+	poolsMutex.lock();
+	for (auto *pool : pools) {
+		pool->runMutex.lock();
+		pool->stop();
+	}
+}
 
-	if (!file.write(reinterpret_cast<const char *>(templateData.data()),
-	    static_cast<std::streamsize>(templateData.size())))
-		return {ReturnStatus::Result::Failure, "Unable to write to "
-		    "identifier '" + identifier + "'"};
+void
+ELFT::RandomImplementation::ScanPool::finishFork()
+{
+	for (auto *pool : pools) {
+		/* On failure, run() tries again and reports the error */
+		try {
+			pool->start();
+		} catch (...) {}
+		pool->runMutex.unlock();
+	}
+	poolsMutex.unlock();
+}
 
-	return {};
+ELFT::RandomImplementation::ScanPool::~ScanPool()
+{
+	std::lock_guard lock{poolsMutex};
+	pools.erase(std::find(pools.begin(), pools.end(), this));
+	this->stop();
 }
 
 #ifdef DEBUG
@@ -203,11 +470,12 @@ ELFT::RandomImplementation::Util::operator<<(
 
 ELFT::RandomImplementation::ExtractionImplementation::ExtractionImplementation(
     const std::filesystem::path &configurationDirectory) :
-    ELFT::ExtractionInterface(),
-    rng{RandomImplementation::Util::loadConfiguration(
-        configurationDirectory).seed}
+    ELFT::ExtractionInterface()
 {
-
+	const auto config = RandomImplementation::Util::loadConfiguration(
+	    configurationDirectory);
+	this->seed = config.seed;
+	this->buildThreads = config.buildThreads;
 }
 
 ELFT::ExtractionInterface::SubmissionIdentification
@@ -253,6 +521,8 @@ ELFT::RandomImplementation::ExtractionImplementation::createTemplate(
         std::optional<ELFT::Image>, std::optional<ELFT::EFS>>> &samples)
     const
 {
+	std::mt19937_64 rng{Util::deriveSeed(this->seed, identifier)};
+
 	std::vector<std::byte> combinedTemplate{};
 	for (const auto &c : identifier)
 		combinedTemplate.push_back(static_cast<std::byte>(c));
@@ -286,7 +556,7 @@ ELFT::RandomImplementation::ExtractionImplementation::createTemplate(
 
 		/* Generare a random amount of 0s and record */
 		const uint8_t templateSize{static_cast<uint8_t>(
-		    this->rng() % UINT8_MAX)};
+		    rng() % UINT8_MAX)};
 		combinedTemplate.push_back(static_cast<std::byte>(
 		    templateSize));
 		combinedTemplate.insert(combinedTemplate.end(),
@@ -314,7 +584,16 @@ ELFT::RandomImplementation::ExtractionImplementation::extractTemplateData(
     const ELFT::CreateTemplateResult &templateResult)
     const
 {
-	const auto templates = Util::parseTemplate(templateResult.data);
+	std::vector<Tmpl> templates{};
+	try {
+		templates = Util::parseTemplate(templateResult.data);
+	} catch (const std::exception &e) {
+		return (std::make_tuple(ReturnStatus{
+		    ReturnStatus::Result::Failure, e.what()},
+		    std::vector<TemplateData>{}));
+	}
+	std::mt19937_64 rng{Util::deriveSeed(this->seed,
+	    templateResult.data.data(), templateResult.data.size())};
 
 	std::vector<TemplateData> tds{};
 	for (const auto &t : templates) {
@@ -325,25 +604,24 @@ ELFT::RandomImplementation::ExtractionImplementation::extractTemplateData(
 		/* Make up a couple features */
 		EFS efs{};
 		if (templateType == TemplateType::Probe) {
-			efs.orientation = (this->rng() % 180);
+			efs.orientation = (rng() % 180);
 			if (*efs.orientation % 2)
 				(*efs.orientation) = static_cast<int16_t>(
 				    efs.orientation.value() * -1);
 		}
 
 		const uint8_t numMinutiae{static_cast<uint8_t>(
-		    this->rng() % UINT8_MAX)};
+		    rng() % UINT8_MAX)};
 		if (numMinutiae > 0) {
 			efs.minutiae = std::vector<Minutia>{};
 			efs.minutiae->reserve(numMinutiae);
 			for (uint8_t i{}; i < numMinutiae; ++i) {
 				Minutia m{};
 				m.coordinate.x = static_cast<uint16_t>(
-				    this->rng() % 1000);
+				    rng() % 1000);
 				m.coordinate.y = static_cast<uint16_t>(
-				    this->rng() % 1000);
-				m.theta = static_cast<uint16_t>(
-				    this->rng() % 360);
+				    rng() % 1000);
+				m.theta = static_cast<uint16_t>(rng() % 360);
 
 				efs.minutiae->push_back(m);
 			}
@@ -363,154 +641,192 @@ ELFT::RandomImplementation::ExtractionImplementation::createReferenceDatabase(
     const uint64_t maxSize)
     const
 {
-	/* First, do a rough check that we have enough space */
-	std::ifstream archive{referenceTemplates.archive,
-	    std::ios_base::in | std::ios_base::ate | std::ios_base::binary};
-	if (!archive.is_open())
-		return {ReturnStatus::Result::Failure, "Could not open "
-		    "TemplateArchive.archive: " +
-		    referenceTemplates.archive.string()};
-	const auto templateBytes = archive.tellg();
-	archive.close();
-
-	if (templateBytes == std::ifstream::pos_type(-1))
-		return {ReturnStatus::Result::Failure, "Size of " +
-		    referenceTemplates.archive.string() + " could not be "
-		    "determined"};
-	if (maxSize < static_cast<uint64_t>(
-	    static_cast<double>(templateBytes) * 1.1))
-		return {ReturnStatus::Result::Failure, "Given " +
-		    std::to_string(templateBytes) + " bytes of templates, " +
-		    std::to_string(maxSize) + " is not enough storage space "
-		    "for the reference database. Estimated size required is "
-		    "1.1x the size of templates."};
-
-	struct ManifestEntryPosition
-	{
-		std::streamsize length{};
-		std::ifstream::pos_type offset{};
-	};
-	std::unordered_map<std::string, ManifestEntryPosition> templates{};
+	/*
+	 * Read the manifest and map the archive. Note that this may contain
+	 * many millions of entries.
+	 */
+	std::optional<TemplateArchiveReader> reader{};
+	try {
+		reader.emplace(referenceTemplates, this->buildThreads);
+	} catch (const std::exception &e) {
+		return {ReturnStatus::Result::Failure, e.what()};
+	}
+	const auto &manifest = reader->getManifest();
+	const auto &entries = manifest.getEntries();
 
 	/*
-	 * Read manifest into a map. Note that this may contain many millions of
-	 * entries.
+	 * Sorting by identifier lets search look up templates directly.
+	 * Failed extractions have no template to store.
 	 */
-	std::ifstream manifest{referenceTemplates.manifest};
-	std::string id{}, length{}, offset{};
-	while (true) {
-		manifest >> id >> length >> offset;
-		if (!manifest)
-			break;
+	std::vector<std::size_t> byIdentifier{};
+	byIdentifier.reserve(entries.size());
+	for (std::size_t i{}; i < entries.size(); ++i)
+		if (entries[i].length != 0)
+			byIdentifier.push_back(i);
+	std::sort(byIdentifier.begin(), byIdentifier.end(),
+	    [&manifest, &entries](const std::size_t lhs, const std::size_t rhs)
+	    -> bool {
+		return (manifest.getIdentifier(entries[lhs]) <
+		    manifest.getIdentifier(entries[rhs]));
+	});
 
-		templates[id] = ManifestEntryPosition{
-		    static_cast<std::streamsize>(std::stoll(length)),
-		    static_cast<std::ifstream::pos_type>(std::stoll(offset))};
+	/*
+	 * NOTE: There will be millions of identifiers. Avoid putting everything
+	 * in a single directory. We write a single database file instead:
+	 * a header, a sorted index, all identifiers, and then all templates,
+	 * so that SearchImplementation can mmap() the file as-is.
+	 */
+	Database::Header header{};
+	header.magic = Database::Magic;
+	header.version = Database::Version;
+	header.count = byIdentifier.size();
+	header.indexOffset = sizeof(Database::Header);
+	header.identifierOffset = header.indexOffset +
+	    (header.count * sizeof(Database::IndexEntry));
+
+	std::vector<Database::IndexEntry> index(byIdentifier.size());
+	uint64_t identifierBytes{}, dataBytes{};
+	for (std::size_t k{}; k < byIdentifier.size(); ++k) {
+		const auto &entry = entries[byIdentifier[k]];
+		index[k].identifierOffset = identifierBytes;
+		index[k].identifierLength = entry.identifierLength;
+		index[k].dataLength = entry.length;
+
+		identifierBytes += entry.identifierLength;
 	}
 
 	/*
-	 * NOTE: There will be millions of identifiers. Avoid putting everything
-	 * in a single directory. Preferably, use some sort of database file.
-	 * One such database file, TemplateArchive, is provided to you! Use it!
-	 *
+	 * Templates are stored in the same order they appear in the archive,
+	 * so that both the archive and the database are accessed
+	 * sequentially. The index (sorted by identifier) records where each
+	 * one landed.
+	 */
+	std::vector<uint64_t> dataOffsets(entries.size());
+	for (std::size_t i{}; i < entries.size(); ++i) {
+		dataOffsets[i] = dataBytes;
+		dataBytes += entries[i].length;
+	}
+	for (std::size_t k{}; k < byIdentifier.size(); ++k)
+		index[k].dataOffset = dataOffsets[byIdentifier[k]];
+	header.dataOffset = header.identifierOffset + identifierBytes;
+	header.frgpOffset = header.dataOffset + dataBytes;
+
+	/*
 	 * NOTE: This method should take advantage of available hardware.
-	 * A single thread writing to disk will likely not complete in the
-	 * required amount of time.
+	 * A single thread will likely not complete in the required amount of
+	 * time. Ranges of templates are processed in parallel, first to
+	 * record the positions within each template for the catalog, and
+	 * then to copy them into their precomputed place in the data region.
 	 */
+	std::vector<std::vector<uint8_t>> frgps(entries.size());
+	try {
+		reader->forEachRange([&](const std::size_t begin,
+		    const std::size_t end) {
+			for (auto i = begin; i < end; ++i) {
+				if (entries[i].length == 0)
+					continue;
+				const auto tmpl = reader->at(i);
+				for (const auto &t : TmplView{tmpl.data,
+				    tmpl.size})
+					frgps[i].push_back(static_cast<uint8_t>(
+					    t.frgp));
+			}
+		});
+	} catch (const std::exception &e) {
+		return {ReturnStatus::Result::Failure, e.what()};
+	}
 
-	auto threadWrite = [](
-	    const std::filesystem::path &archivePath,
-	    const std::string &dbDir,
-	    const std::unordered_map<std::string, ManifestEntryPosition>::
-	        const_iterator &begin,
-	    const std::unordered_map<std::string, ManifestEntryPosition>::
-	        const_iterator &end) ->
-	    ReturnStatus{
-		try {
-			std::ifstream archive{archivePath,
-			    std::ios_base::in | std::ios_base::binary};
-
-			std::for_each(begin, end, [&dbDir, &archive](
-			    const auto &manifestEntry) {
-				if (manifestEntry.second.length == 0)
-					return;
-
-				/* Read the template from the archive */
-				std::vector<std::byte> combinedTemplate{};
-				combinedTemplate.resize(static_cast<
-				    std::vector<std::byte>::size_type>(
-				    manifestEntry.second.length));
-				archive.seekg(manifestEntry.second.offset);
-				archive.read(reinterpret_cast<char*>(
-				    combinedTemplate.data()),
-				    manifestEntry.second.length);
-
-				/* Write it back out as an individual file */
-				const auto rs = Util::writeTemplate(
-				    dbDir / Util::getDirectoryForTemplate(
-				    combinedTemplate), combinedTemplate);
-				if (!rs)
-					throw rs;
-			});
-		} catch (const ReturnStatus &rs) {
-			return (rs);
-		}
+	/* The catalog is the last region, so the final size is now known */
+	std::vector<uint8_t> catalog{};
+	for (std::size_t k{}; k < byIdentifier.size(); ++k) {
+		const auto &positions = frgps[byIdentifier[k]];
+		index[k].frgpOffset = catalog.size();
+		index[k].frgpCount = static_cast<uint32_t>(positions.size());
+		catalog.insert(catalog.end(), positions.cbegin(),
+		    positions.cend());
+	}
+	header.size = header.frgpOffset + catalog.size();
+	if (header.size > maxSize)
+		return {ReturnStatus::Result::Failure, "Reference database "
+		    "requires " + std::to_string(header.size) + " bytes, but "
+		    "only " + std::to_string(maxSize) + " are available"};
+
+	const auto dbPath = databaseDirectory /
+	    Constants::databaseFileName;
+	const int fd{::open(dbPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+	    S_IRUSR | S_IWUSR | S_IRGRP)};
+	if (fd == -1)
+		return {ReturnStatus::Result::Failure, "Could not create " +
+		    dbPath.string()};
+	if (::ftruncate(fd, static_cast<off_t>(header.size)) != 0) {
+		::close(fd);
+		return {ReturnStatus::Result::Failure, "Could not size " +
+		    dbPath.string()};
+	}
 
-		return {};
-	};
+	try {
+		reader->forEachRange([&](const std::size_t begin,
+		    const std::size_t end) {
+			/* Templates are usually back to back in the archive */
+			uint64_t length{};
+			bool contiguous{true};
+			for (auto i = begin; i < end; ++i) {
+				if ((i > begin) && (entries[i].offset !=
+				    (entries[i - 1].offset +
+				    entries[i - 1].length)))
+					contiguous = false;
+				length += entries[i].length;
+			}
 
-	/*
-	 * For small databases (e.g., validation), you might not need to
-	 * multithread.
-	 */
-	bool shouldMultithread{true};
-	if (templateBytes < 10000)
-		shouldMultithread = false;
-	if (!shouldMultithread)
-		return (threadWrite(referenceTemplates.archive,
-		    databaseDirectory, templates.cbegin(), templates.cend()));
-
-	const auto numCores = std::thread::hardware_concurrency() - 1;
-	std::vector<std::future<ReturnStatus>> futures{};
-	futures.reserve(numCores);
-
-	const uint64_t tmplPerThread{static_cast<uint64_t>(std::floor(
-	    templates.size() / numCores))};
-	for (unsigned int i{0}; i < numCores; ++i) {
-		if ((((i + 1) * tmplPerThread)) > PTRDIFF_MAX)
-			return {ReturnStatus::Result::Failure,
-			    "Iterator size too large for ptrdiff_t"};
-
-		futures.emplace_back(std::async(std::launch::async,
-		    threadWrite, referenceTemplates.archive, databaseDirectory,
-		    std::next(templates.cbegin(),
-		        static_cast<std::ptrdiff_t>(i * tmplPerThread)),
-		    ((i == numCores - 1) ?
-		        templates.cend() :
-		        std::next(templates.cbegin(),
-		        static_cast<std::ptrdiff_t>(
-		            ((i + 1) * tmplPerThread))))));
-	}
-
-	ReturnStatus rs{};
-	for (unsigned int i{0}; i < futures.size(); ++i) {
-		const auto futureRS = futures.at(i).get();
-
-		if (futureRS.message) {
-			if (!rs.message)
-				rs.message = std::string{};
-
-			*rs.message = "Thread " + std::to_string(i) + ": " +
-			    *futureRS.message + ' ';
-		}
+			/* Write them all into their spot in the database */
+			thread_local std::vector<std::byte> gathered{};
+			const std::byte *data{reader->at(begin).data};
+			if (!contiguous) {
+				gathered.clear();
+				for (auto i = begin; i < end; ++i) {
+					const auto tmpl = reader->at(i);
+					gathered.insert(gathered.end(),
+					    tmpl.data, tmpl.data + tmpl.size);
+				}
+				data = gathered.data();
+			}
+			if (!Util::writeAt(fd, data,
+			    static_cast<std::size_t>(length),
+			    header.dataOffset + dataOffsets[begin]))
+				throw std::runtime_error{"Could not write " +
+				    dbPath.string()};
+		});
+	} catch (const std::exception &e) {
+		::close(fd);
+		return {ReturnStatus::Result::Failure, e.what()};
+	}
+
+	/* Everything before the templates is small, so write it at once */
+	std::vector<char> metadata{};
+	metadata.reserve(static_cast<std::size_t>(header.dataOffset));
+	metadata.insert(metadata.end(), reinterpret_cast<char*>(&header),
+	    reinterpret_cast<char*>(&header) + sizeof(header));
+	metadata.insert(metadata.end(), reinterpret_cast<char*>(index.data()),
+	    reinterpret_cast<char*>(index.data() + index.size()));
+	for (const auto &i : byIdentifier) {
+		const auto identifier = manifest.getIdentifier(entries[i]);
+		metadata.insert(metadata.end(), identifier.cbegin(),
+		    identifier.cend());
+	}
 
-		if (!futureRS)
-			rs.result = ReturnStatus::Result::Failure;
+	if (!Util::writeAt(fd, metadata.data(), metadata.size(), 0) ||
+	    !Util::writeAt(fd, catalog.data(), catalog.size(),
+	    header.frgpOffset)) {
+		::close(fd);
+		return {ReturnStatus::Result::Failure, "Could not write " +
+		    dbPath.string()};
 	}
-	if (rs.message && !rs.message->empty())
-		rs.message->pop_back();
 
-	return (rs);
+	if (::close(fd) != 0)
+		return {ReturnStatus::Result::Failure, "Could not close " +
+		    dbPath.string()};
+
+	return {};
 }
 
 std::shared_ptr<ELFT::ExtractionInterface>
@@ -528,99 +844,325 @@ ELFT::RandomImplementation::SearchImplementation::SearchImplementation(
     const std::filesystem::path &configurationDirectory,
     const std::filesystem::path &databaseDirectory) :
     ELFT::SearchInterface(),
-    databaseDirectory{databaseDirectory},
-    rng{RandomImplementation::Util::loadConfiguration(
-        configurationDirectory).seed}
+    databaseDirectory{databaseDirectory}
+{
+	const auto config = RandomImplementation::Util::loadConfiguration(
+	    configurationDirectory);
+	this->seed = config.seed;
+	this->searchThreads = config.searchThreads;
+}
+
+ELFT::RandomImplementation::SearchImplementation::~SearchImplementation()
 {
+	/* Stop searching before the database is unmapped */
+	this->scanPool.reset();
 
+	if (this->database != nullptr)
+		::munmap(const_cast<std::byte*>(this->database),
+		    this->databaseSize);
 }
 
 ELFT::ReturnStatus
 ELFT::RandomImplementation::SearchImplementation::load(
     const uint64_t maxSize)
 {
+	if (this->database != nullptr)
+		return {};
+
+	const auto dbPath = this->databaseDirectory /
+	    Constants::databaseFileName;
+	const int fd{::open(dbPath.c_str(), O_RDONLY)};
+	if (fd == -1)
+		return {ReturnStatus::Result::Failure, "Could not open " +
+		    dbPath.string()};
+
+	struct stat sb{};
+	if ((::fstat(fd, &sb) != 0) || (static_cast<uint64_t>(sb.st_size) <
+	    sizeof(Database::Header))) {
+		::close(fd);
+		return {ReturnStatus::Result::Failure, "Invalid reference "
+		    "database: " + dbPath.string()};
+	}
+	const auto size = static_cast<std::size_t>(sb.st_size);
+
 	/*
-	 * XXX: This method is not implemented, because this trivial algorithm
-	 *      only reads from disk. You shouldn't be this simple, so we
-	 *      suggest implementing something like the below.
+	 * If the entire database fits within maxSize, fault it all into
+	 * memory now. Otherwise, let the kernel page in what search() needs.
+	 * Either way, the mapping is read-only and shared between any
+	 * processes fork()ed after this method returns.
 	 */
+	int flags{MAP_PRIVATE};
+	if (size <= maxSize)
+		flags |= MAP_POPULATE;
+	void *mapping = ::mmap(nullptr, size, PROT_READ, flags, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		return {ReturnStatus::Result::Failure, "Could not map " +
+		    dbPath.string()};
+	if (size > maxSize)
+		::madvise(mapping, size, MADV_RANDOM);
+
+	/* Whether [offset, offset + length) lies within [0, regionSize) */
+	const auto fits = [](const uint64_t offset, const uint64_t length,
+	    const uint64_t regionSize) -> bool {
+		return ((length <= regionSize) &&
+		    (offset <= (regionSize - length)));
+	};
 
-	/* Can we load *everything* into RAM? */
-	const uint64_t templateBytes = /* how much space do you need */ 1;
+	/*
+	 * Regions are back to back, so checking their order bounds each by
+	 * the next. Written to not overflow, since the file may be corrupt.
+	 */
+	const auto *header = static_cast<const Database::Header*>(mapping);
+	if ((header->magic != Database::Magic) ||
+	    (header->version != Database::Version) ||
+	    (header->size != size) ||
+	    (header->indexOffset < sizeof(Database::Header)) ||
+	    ((header->indexOffset % alignof(Database::IndexEntry)) != 0) ||
+	    (header->indexOffset > header->identifierOffset) ||
+	    (header->identifierOffset > header->dataOffset) ||
+	    (header->dataOffset > header->frgpOffset) ||
+	    (header->frgpOffset > header->size) ||
+	    (header->count > ((header->identifierOffset -
+	    header->indexOffset) / sizeof(Database::IndexEntry)))) {
+		::munmap(mapping, size);
+		return {ReturnStatus::Result::Failure, "Invalid reference "
+		    "database: " + dbPath.string()};
+	}
 
-	if (maxSize < templateBytes) {
-		/* We could load the entire database into RAM. */
-	} else {
-		/*
-		 * We could load some of the database, but the rest would
-		 * required reading from disk.
-		 */
+	/* Every entry must point within its regions */
+	const auto *index = reinterpret_cast<const Database::IndexEntry*>(
+	    static_cast<const std::byte*>(mapping) + header->indexOffset);
+	const uint64_t identifierBytes{header->dataOffset -
+	    header->identifierOffset};
+	const uint64_t dataBytes{header->frgpOffset - header->dataOffset};
+	const uint64_t frgpBytes{header->size - header->frgpOffset};
+	for (uint64_t i{}; i < header->count; ++i) {
+		const auto &entry = index[i];
+		if (!fits(entry.identifierOffset, entry.identifierLength,
+		    identifierBytes) ||
+		    !fits(entry.dataOffset, entry.dataLength, dataBytes) ||
+		    !fits(entry.frgpOffset, entry.frgpCount, frgpBytes)) {
+			::munmap(mapping, size);
+			return {ReturnStatus::Result::Failure, "Invalid "
+			    "reference database (entry " + std::to_string(i) +
+			    "): " + dbPath.string()};
+		}
 	}
 
+	this->database = static_cast<const std::byte*>(mapping);
+	this->databaseSize = size;
+	this->header = header;
+	this->index = index;
+
+	/*
+	 * Nothing shared is modified by search(), so fork() may follow.
+	 * The pool's threads are restarted in each process fork()ed later.
+	 */
+	if (this->searchThreads > 1)
+		this->scanPool = std::make_unique<ScanPool>(
+		    this->searchThreads);
+
 	return {};
 }
 
-std::optional<ELFT::ProductIdentifier>
-ELFT::RandomImplementation::SearchImplementation::getIdentification()
+const ELFT::RandomImplementation::Database::IndexEntry*
+ELFT::RandomImplementation::SearchImplementation::findReference(
+    const std::string &identifier)
     const
 {
-	ProductIdentifier id{};
-	id.marketing = "RandomImplementation Matcher 1.0";
-	ProductIdentifier::CBEFFIdentifier cbeff{};
-	cbeff.owner = RandomImplementation::Constants::productOwner;
-	cbeff.algorithm = 0x0101;
-	id.cbeff = cbeff;
+	const auto end = this->index + this->header->count;
+	const auto entry = std::lower_bound(this->index, end, identifier,
+	    [this](const Database::IndexEntry &e, const std::string &id) ->
+	    bool {
+		return (this->getIdentifier(e) < id);
+	});
+	if ((entry == end) || (this->getIdentifier(*entry) != identifier))
+		return (nullptr);
+
+	return (entry);
+}
 
-	return (id);
+std::string_view
+ELFT::RandomImplementation::SearchImplementation::getIdentifier(
+    const Database::IndexEntry &entry)
+    const
+{
+	return {reinterpret_cast<const char*>(this->database +
+	    this->header->identifierOffset + entry.identifierOffset),
+	    entry.identifierLength};
 }
 
-ELFT::SearchResult
-ELFT::RandomImplementation::SearchImplementation::search(
-    const std::vector<std::byte> &probeTemplate,
-    const uint16_t maxCandidates)
+const uint8_t*
+ELFT::RandomImplementation::SearchImplementation::getFRGPs(
+    const Database::IndexEntry &entry)
     const
 {
-	ELFT::SearchResult result{};
-	result.candidateList.reserve(maxCandidates);
+	return (reinterpret_cast<const uint8_t*>(this->database +
+	    this->header->frgpOffset + entry.frgpOffset));
+}
 
-	/* Get some real candidate names */
-	for (const auto &f : std::filesystem::recursive_directory_iterator(
-	    this->databaseDirectory)) {
-		if (!f.is_regular_file())
-			continue;
+ELFT::RandomImplementation::TmplView
+ELFT::RandomImplementation::SearchImplementation::viewReference(
+    const Database::IndexEntry &entry)
+    const
+{
+	return {this->database + this->header->dataOffset + entry.dataOffset,
+	    static_cast<std::size_t>(entry.dataLength)};
+}
 
-		const auto &templates = Util::parseTemplate(f.path());
-		const auto &matchingTemplate = templates.at(
-		    this->rng() % templates.size());
+std::tuple<double, ELFT::FrictionRidgeGeneralizedPosition>
+ELFT::RandomImplementation::SearchImplementation::scoreReference(
+    const uint64_t probeKey,
+    const Database::IndexEntry &entry)
+    const
+{
+	const auto referenceKey = Util::deriveSeed(probeKey,
+	    this->getIdentifier(entry));
+	const auto *frgps = reinterpret_cast<const std::byte*>(
+	    this->getFRGPs(entry));
+
+	/* Highest-scoring position wins, and ties go to the first */
+	double best{-1};
+	FrictionRidgeGeneralizedPosition bestFRGP{};
+	for (uint32_t i{}; i < entry.frgpCount; ++i) {
+		Util::CounterEngine scores{Util::deriveSeed(referenceKey,
+		    &frgps[i], 1)};
+		const auto similarity = static_cast<double>(
+		    scores() % UINT16_MAX);
+		if (similarity <= best)
+			continue;
+		best = similarity;
 
 		/* Set a realistic FRGP for slap templates */
-		auto frgp = matchingTemplate.frgp;
+		auto frgp = static_cast<FrictionRidgeGeneralizedPosition>(
+		    frgps[i]);
 		switch (frgp) {
 		case FrictionRidgeGeneralizedPosition::RightFour:
 			frgp = static_cast<FrictionRidgeGeneralizedPosition>(
-			    (this->rng() % 4) + 2);
+			    (scores() % 4) + 2);
 			break;
 		case FrictionRidgeGeneralizedPosition::LeftFour:
 			frgp = static_cast<FrictionRidgeGeneralizedPosition>(
-			    (this->rng() % 4) + 7);
+			    (scores() % 4) + 7);
 			break;
 		case FrictionRidgeGeneralizedPosition::RightAndLeftThumbs:
 			frgp = static_cast<FrictionRidgeGeneralizedPosition>(
-			    (this->rng() % 2) + 5);
+			    (scores() % 2) + 5);
 			break;
 		default:
 			break;
 		}
+		bestFRGP = frgp;
+	}
 
-		result.candidateList.push_back({
-		    matchingTemplate.candidateIdentifier, frgp,
-		    static_cast<double>(this->rng() % UINT16_MAX)});
+	return {best, bestFRGP};
+}
 
-		if (result.candidateList.size() == maxCandidates)
-			break;
+void
+ELFT::RandomImplementation::SearchImplementation::scanReferences(
+    const uint64_t begin,
+    const uint64_t end,
+    const uint64_t probeKey,
+    TopKAccumulator &topK)
+    const
+{
+	for (uint64_t i{begin}; i < end; ++i) {
+		if (this->index[i].frgpCount == 0)
+			continue;
+
+		topK.offer(std::get<double>(this->scoreReference(probeKey,
+		    this->index[i])), i);
+	}
+}
+
+
+std::optional<ELFT::ProductIdentifier>
+ELFT::RandomImplementation::SearchImplementation::getIdentification()
+    const
+{
+	ProductIdentifier id{};
+	id.marketing = "RandomImplementation Matcher 1.0";
+	ProductIdentifier::CBEFFIdentifier cbeff{};
+	cbeff.owner = RandomImplementation::Constants::productOwner;
+	cbeff.algorithm = 0x0101;
+	id.cbeff = cbeff;
+
+	return (id);
+}
+
+ELFT::SearchResult
+ELFT::RandomImplementation::SearchImplementation::search(
+    const std::vector<std::byte> &probeTemplate,
+    const uint16_t maxCandidates)
+    const
+{
+	ELFT::SearchResult result{};
+
+	if ((this->database == nullptr) || (this->header == nullptr)) {
+		this->setLastCallMetrics({});
+		result.status = {ReturnStatus::Result::Failure,
+		    "load() was not called or failed"};
+		return (result);
+	}
+
+	/* Scores depend on the probe identifier, not the whole template */
+	std::optional<TmplView> probeView{};
+	try {
+		probeView.emplace(probeTemplate.data(), probeTemplate.size());
+	} catch (const std::exception &e) {
+		this->setLastCallMetrics({});
+		result.status = {ReturnStatus::Result::Failure, e.what()};
+		return (result);
+	}
+	const auto probeKey = Util::deriveSeed(this->seed,
+	    probeView->getIdentifier());
+
+	const auto scanStart = std::chrono::steady_clock::now();
+
+	/*
+	 * Score every reference, keeping only the best. The index is sorted
+	 * by identifier, so ranking ties by position needs no string compare.
+	 * With more than one thread, each scores a contiguous shard of the
+	 * index into its own accumulator, and the shards are merged. Scores
+	 * and ties do not depend on the shards, so the result is identical.
+	 */
+	const auto count = this->header->count;
+	const unsigned int shards{this->scanPool ?
+	    this->scanPool->getNumShards() : 1};
+	std::vector<TopKAccumulator> shardTopK{};
+	shardTopK.reserve(shards);
+	for (unsigned int shard{}; shard < shards; ++shard)
+		shardTopK.emplace_back(maxCandidates);
+
+	const auto scanShard = [&](const unsigned int shard) {
+		this->scanReferences((count * shard) / shards,
+		    (count * (shard + 1)) / shards, probeKey,
+		    shardTopK[shard]);
+	};
+	if (shards == 1)
+		scanShard(0);
+	else
+		this->scanPool->run(scanShard);
+
+	auto &topK = shardTopK.front();
+	for (unsigned int shard{1}; shard < shards; ++shard)
+		topK.merge(shardTopK[shard]);
+
+	/* Only build Candidate for the references that were kept */
+	result.candidateList.reserve(topK.size());
+	for (const auto &kept : topK.rank()) {
+		const auto &entry = this->index[kept.key];
+		const auto frgp = std::get<FrictionRidgeGeneralizedPosition>(
+		    this->scoreReference(probeKey, entry));
+
+		result.candidateList.push_back({
+		    std::string{this->getIdentifier(entry)}, frgp,
+		    kept.similarity});
 	}
 
-	result.decision = ((this->rng() % 2) == 0);
+	result.decision = ((Util::CounterEngine{probeKey}() % 2) == 0);
+	const auto scanStop = std::chrono::steady_clock::now();
 
 	/*
 	 * We can set correspondence here or wait to have extractCorrespondence
@@ -630,6 +1172,21 @@ ELFT::RandomImplementation::SearchImplementation::search(
 	    probeTemplate, result);
 	if (correspondence && correspondence->status)
 		result.correspondence = correspondence->data;
+	const auto correspondenceStop = std::chrono::steady_clock::now();
+
+	const auto us = [](const std::chrono::steady_clock::duration &d) {
+		return (static_cast<uint64_t>(std::chrono::duration_cast<
+		    std::chrono::microseconds>(d).count()));
+	};
+	CallMetrics metrics{};
+	metrics.stages = {{"scan", us(scanStop - scanStart)},
+	    {"correspondence", us(correspondenceStop - scanStop)}};
+	metrics.counters = {
+	    {"references_scanned", static_cast<double>(count)},
+	    {"shards", static_cast<double>(shards)},
+	    {"candidates", static_cast<double>(
+	    result.candidateList.size())}};
+	this->setLastCallMetrics(std::move(metrics));
 
 	return (result);
 }
@@ -640,14 +1197,49 @@ ELFT::RandomImplementation::SearchImplementation::extractCorrespondence(
     const SearchResult &searchResult)
     const
 {
-	const auto probe = Util::parseTemplate(probeTemplate).front();
+	if ((this->database == nullptr) || (this->header == nullptr)) {
+		this->setLastCallMetrics({});
+		return (CorrespondenceResult{{ReturnStatus::Result::Failure,
+		    "load() was not called or failed"}, {}});
+	}
+
+	std::optional<TmplView> probeView{};
+	try {
+		probeView.emplace(probeTemplate.data(), probeTemplate.size());
+	} catch (const std::exception &e) {
+		this->setLastCallMetrics({});
+		return (CorrespondenceResult{{ReturnStatus::Result::Failure,
+		    e.what()}, {}});
+	}
+	const auto probe = *probeView->begin();
+	const std::string probeIdentifier{probeView->getIdentifier()};
+	const auto probeSeed = Util::deriveSeed(this->seed,
+	    probeTemplate.data(), probeTemplate.size());
 	std::vector<std::vector<ELFT::Correspondence>> allCorrespondence{};
 	allCorrespondence.reserve(searchResult.candidateList.size());
 
+	uint64_t referencesParsed{};
 	for (const auto &c : searchResult.candidateList) {
-		const auto &referenceTemplates = Util::parseTemplate(
-		    this->databaseDirectory / Util::getDirectoryForIdentifier(
-		    c.identifier) / c.identifier);
+		const auto reference = this->findReference(c.identifier);
+		if (reference == nullptr)
+			continue;
+		/*
+		 * load() only bounds the stored template, and empty templates
+		 * are stored as given, so its contents may still be invalid.
+		 */
+		std::optional<TmplView> referenceView{};
+		try {
+			referenceView.emplace(this->viewReference(*reference));
+		} catch (const std::exception &e) {
+			this->setLastCallMetrics({});
+			return (CorrespondenceResult{{
+			    ReturnStatus::Result::Failure, "Reference " +
+			    c.identifier + ": " + e.what()}, {}});
+		}
+		const auto &referenceTemplates = *referenceView;
+		const std::string referenceIdentifier{
+		    referenceTemplates.getIdentifier()};
+		++referencesParsed;
 
 		/* NOTE: See NOTE below. This won't line up. */
 		bool onlySlaps{true};
@@ -687,8 +1279,11 @@ ELFT::RandomImplementation::SearchImplementation::extractCorrespondence(
 					continue;
 			}
 
+			/* Same probe and candidate, same correspondence */
+			std::mt19937_64 rng{Util::deriveSeed(probeSeed,
+			    c.identifier)};
 			const uint8_t numMinutiae{static_cast<uint8_t>(
-			    this->rng() % UINT8_MAX)};
+			    rng() % UINT8_MAX)};
 
 			std::vector<Correspondence> candidateCorr{};
 			candidateCorr.reserve(numMinutiae);
@@ -697,10 +1292,9 @@ ELFT::RandomImplementation::SearchImplementation::extractCorrespondence(
 
 				singleCorr.type = CorrespondenceType::Definite;
 
-				singleCorr.probeIdentifier =
-				    probe.candidateIdentifier;
+				singleCorr.probeIdentifier = probeIdentifier;
 				singleCorr.referenceIdentifier =
-				    tmpl.candidateIdentifier;
+				    referenceIdentifier;
 
 				singleCorr.probeInputIdentifier =
 				    probe.inputIdentifier;
@@ -708,18 +1302,18 @@ ELFT::RandomImplementation::SearchImplementation::extractCorrespondence(
 				    tmpl.inputIdentifier;
 
 				singleCorr.probeMinutia.coordinate.x =
-				    static_cast<uint16_t>(this->rng() % 1000);
+				    static_cast<uint16_t>(rng() % 1000);
 				singleCorr.probeMinutia.coordinate.y =
-				    static_cast<uint16_t>(this->rng() % 1000);
+				    static_cast<uint16_t>(rng() % 1000);
 				singleCorr.probeMinutia.theta =
-				    static_cast<uint16_t>(this->rng() % 360);
+				    static_cast<uint16_t>(rng() % 360);
 
 				singleCorr.referenceMinutia.coordinate.x =
-				    static_cast<uint16_t>(this->rng() % 1000);
+				    static_cast<uint16_t>(rng() % 1000);
 				singleCorr.referenceMinutia.coordinate.y =
-				    static_cast<uint16_t>(this->rng() % 1000);
+				    static_cast<uint16_t>(rng() % 1000);
 				singleCorr.referenceMinutia.theta =
-				    static_cast<uint16_t>(this->rng() % 16);
+				    static_cast<uint16_t>(rng() % 16);
 
 				candidateCorr.push_back(singleCorr);
 			}
@@ -728,11 +1322,37 @@ ELFT::RandomImplementation::SearchImplementation::extractCorrespondence(
 		}
 	}
 
+	CallMetrics metrics{};
+	metrics.counters = {
+	    {"references_parsed", static_cast<double>(referencesParsed)}};
+	this->setLastCallMetrics(std::move(metrics));
+
 	return (CorrespondenceResult{ReturnStatus{},
 	    {allCorrespondence, false}});
 
 }
 
+std::optional<ELFT::CallMetrics>
+ELFT::RandomImplementation::SearchImplementation::getLastCallMetrics()
+    const
+{
+	std::lock_guard lock{this->lastCallMetricsMutex};
+	const auto metrics = this->lastCallMetrics.find(
+	    std::this_thread::get_id());
+	if (metrics == this->lastCallMetrics.cend())
+		return (CallMetrics{});
+	return (metrics->second);
+}
+
+void
+ELFT::RandomImplementation::SearchImplementation::setLastCallMetrics(
+    CallMetrics metrics)
+    const
+{
+	std::lock_guard lock{this->lastCallMetricsMutex};
+	this->lastCallMetrics[std::this_thread::get_id()] = std::move(metrics);
+}
+
 std::shared_ptr<ELFT::SearchInterface>
 ELFT::SearchInterface::getImplementation(
     const std::filesystem::path &configurationDirectory,
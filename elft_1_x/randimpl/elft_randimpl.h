@@ -11,9 +11,19 @@
 #ifndef ELFT_RANDIMPL_H_
 #define ELFT_RANDIMPL_H_
 
+#include <array>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 
 #include <elft.h>
+#include <elft_topk.h>
 
 #ifdef DEBUG
 #include <ostream>
@@ -28,6 +38,10 @@ namespace ELFT
 		{
 			/** Random-number engine seed. */
 			std::uint_fast32_t seed{};
+			/** Threads used in createReferenceDatabase(). */
+			unsigned int buildThreads{1};
+			/** Threads used in each search(). */
+			unsigned int searchThreads{1};
 		};
 
 		/** Template format */
@@ -46,50 +60,201 @@ namespace ELFT
 			uint8_t size{};
 		};
 
-		namespace Constants
+		/**
+		 * @brief
+		 * Non-owning view of a combined "ELFT" template.
+		 *
+		 * @details
+		 * A combined template is a NUL-terminated identifier followed
+		 * by one or more subtemplates, each an input identifier, a
+		 * FrictionRidgeGeneralizedPosition, and a size byte, followed
+		 * by that many bytes. The whole template is validated once on
+		 * construction, so iterating never reads out of bounds, and
+		 * nothing is copied.
+		 */
+		class TmplView
 		{
-			uint16_t versionNumber{0x0001};
-			uint16_t productOwner{0x000F};
-			std::string libraryIdentifier{"randimpl"};
-			std::string configFileName{"seed"};
-		}
+		public:
+			/** Non-owning view of a single subtemplate. */
+			struct Subtemplate
+			{
+				/** Input identifier from createTemplate(). */
+				uint8_t inputIdentifier{};
+				/** Finger position. */
+				FrictionRidgeGeneralizedPosition frgp{};
+				/** First byte of the subtemplate's data. */
+				const std::byte *data{nullptr};
+				/** Number of bytes at #data. */
+				uint8_t size{};
+			};
+
+			/** Forward iterator over each Subtemplate. */
+			class Iterator
+			{
+			public:
+				/**
+				 * @brief
+				 * Iterator constructor.
+				 *
+				 * @param position
+				 * First byte of a validated subtemplate, or
+				 * the end of the template.
+				 */
+				Iterator(
+				    const std::byte *position);
+
+				/** @return Subtemplate at this position. */
+				Subtemplate
+				operator*()
+				    const
+				    noexcept;
+
+				/** Advance to the next subtemplate. */
+				Iterator&
+				operator++()
+				    noexcept;
+
+				bool
+				operator==(
+				    const Iterator &rhs)
+				    const
+				    noexcept;
+
+				bool
+				operator!=(
+				    const Iterator &rhs)
+				    const
+				    noexcept;
+
+			private:
+				/** First byte of the current subtemplate. */
+				const std::byte *position{nullptr};
+			};
 
-		namespace Util
-		{
 			/**
 			 * @brief
-			 * Obtain parent directory for a template written in
-			 * the reference database.
+			 * TmplView constructor.
 			 *
-			 * @param identifier
-			 * Identifier of the template in the reference database.
+			 * @param data
+			 * First byte of a combined template, which must
+			 * outlive this object.
+			 * @param size
+			 * Number of bytes at `data`.
 			 *
-			 * @return
-			 * Path that is a subdirectory of the reference
-			 * database where `identifier` should be expected to be
-			 * found.
+			 * @throw std::runtime_error
+			 * The identifier is not terminated, there are no
+			 * subtemplates, or a subtemplate extends past `size`.
 			 */
-			std::filesystem::path
-			getDirectoryForIdentifier(
-			    const std::string &identifier);
+			TmplView(
+			    const std::byte *data,
+			    const std::size_t size);
 
 			/**
-			 * @brief
-			 * Obtain parent directory for a template written in
-			 * the reference database.
-			 *
-			 * @param templateData
-			 * Template data with an embedded identifier.
-			 *
 			 * @return
-			 * Path that is a subdirectory of the reference
-			 * database where templateData's identifier should be
-			 * expected to be found.
+			 * Identifier passed to createTemplate(), viewing the
+			 * template.
 			 */
-			std::filesystem::path
-			getDirectoryForTemplate(
-			    const std::vector<std::byte> &templateData);
+			std::string_view
+			getIdentifier()
+			    const
+			    noexcept;
+
+			/** @return Iterator to the first subtemplate. */
+			Iterator
+			begin()
+			    const
+			    noexcept;
+
+			/** @return Iterator past the last subtemplate. */
+			Iterator
+			end()
+			    const
+			    noexcept;
 
+		private:
+			/** Identifier, without terminator. */
+			std::string_view identifier{};
+			/** First byte of the first subtemplate. */
+			const std::byte *first{nullptr};
+			/** One past the last byte of the template. */
+			const std::byte *last{nullptr};
+		};
+
+		namespace Constants
+		{
+			uint16_t versionNumber{0x0001};
+			uint16_t productOwner{0x000F};
+			std::string libraryIdentifier{"randimpl"};
+			std::string configFileName{"seed"};
+			std::string buildThreadsConfigFileName{"build_threads"};
+			std::string searchThreadsConfigFileName{
+			    "search_threads"};
+			std::string databaseFileName{"references.db"};
+		}
+
+		/**
+		 * Layout of the single-file reference database.
+		 *
+		 * @details
+		 * The file is a Header, followed by Header#count IndexEntry
+		 * sorted by identifier, followed by a pool of identifiers, the
+		 * templates from the TemplateArchive packed back to back, and
+		 * finally a catalog of the FrictionRidgeGeneralizedPosition of
+		 * every subtemplate, so search() need not parse templates. All
+		 * integers are stored in host byte order, as the database is
+		 * only ever read on the machine that created it.
+		 */
+		namespace Database
+		{
+			/** Identifies a file as a randimpl reference database. */
+			const std::array<char, 8> Magic{
+			    'R', 'A', 'N', 'D', 'I', 'M', 'P', 'L'};
+			/** Version of the file format. */
+			const uint32_t Version{2};
+
+			/** Fixed-size start of the database file. */
+			struct Header
+			{
+				/** Must be Magic. */
+				std::array<char, 8> magic{};
+				/** Must be Version. */
+				uint32_t version{};
+				/** Unused. */
+				uint32_t reserved{};
+				/** Number of IndexEntry. */
+				uint64_t count{};
+				/** File offset of the first IndexEntry. */
+				uint64_t indexOffset{};
+				/** File offset of the identifier pool. */
+				uint64_t identifierOffset{};
+				/** File offset of the first template. */
+				uint64_t dataOffset{};
+				/** File offset of the FRGP catalog. */
+				uint64_t frgpOffset{};
+				/** Size of the entire file, in bytes. */
+				uint64_t size{};
+			};
+
+			/** Location of a single reference template. */
+			struct IndexEntry
+			{
+				/** Offset of identifier within identifier pool. */
+				uint64_t identifierOffset{};
+				/** Offset of template within data region. */
+				uint64_t dataOffset{};
+				/** Number of bytes in template. */
+				uint64_t dataLength{};
+				/** Offset of first FRGP within FRGP catalog. */
+				uint64_t frgpOffset{};
+				/** Number of bytes in identifier. */
+				uint32_t identifierLength{};
+				/** Number of subtemplates (and FRGPs). */
+				uint32_t frgpCount{};
+			};
+		}
+
+		namespace Util
+		{
 			/**
 			 * @brief
 			 * Read and parse the configuration file.
@@ -105,17 +270,20 @@ namespace ELFT
 			/**
 			 * @brief
 			 * Extract individual "native" templates from single
-			 * "ELFT" template on disk.
+			 * "ELFT" template in memory.
 			 *
-			 * @param pathToTemplate
-			 * Filesystem location of template on disk.
+			 * @param templateData
+			 * Combined "ELFT" template created in createTemplate().
 			 *
 			 * @return
 			 * Collection of individual "native" templates.
+			 *
+			 * @throw std::runtime_error
+			 * The template is malformed (see TmplView).
 			 */
 			std::vector<Tmpl>
 			parseTemplate(
-			    const std::filesystem::path &pathToTemplate);
+			    const std::vector<std::byte> &templateData);
 
 			/**
 			 * @brief
@@ -123,54 +291,163 @@ namespace ELFT
 			 * "ELFT" template in memory.
 			 *
 			 * @param templateData
-			 * Combined "ELFT" template created in createTemplate().
+			 * Pointer to the first byte of a combined "ELFT"
+			 * template created in createTemplate().
+			 * @param size
+			 * Number of bytes pointed to by `templateData`.
 			 *
 			 * @return
 			 * Collection of individual "native" templates.
+			 *
+			 * @throw std::runtime_error
+			 * The template is malformed (see TmplView).
 			 */
 			std::vector<Tmpl>
 			parseTemplate(
-			    const std::vector<std::byte> &templateData);
+			    const std::byte *templateData,
+			    const std::size_t size);
 
 			/**
 			 * @brief
-			 * Read a template from disk.
+			 * Write an entire buffer to a file at an offset.
 			 *
-			 * @param directory
-			 * Enrollment database directory.
-			 * @param identifier
-			 * Identifier to read from disk.
+			 * @param fd
+			 * File descriptor open for writing.
+			 * @param data
+			 * Data to write.
+			 * @param size
+			 * Number of bytes from `data` to write.
+			 * @param offset
+			 * Offset within `fd` at which to write `data`.
 			 *
 			 * @return
-			 * Tuple of ReturnStatus (indicating status of reading
-			 * the template) and the template itself.
+			 * true if all `size` bytes were written, false
+			 * otherwise.
+			 *
+			 * @note
+			 * Does not modify the file offset of `fd`, so may be
+			 * called from multiple threads at once.
 			 */
-			std::tuple<ReturnStatus, std::vector<std::byte>>
-			readTemplate(
-			    const std::filesystem::path &directory,
-			    const std::string &identifier);
+			bool
+			writeAt(
+			    const int fd,
+			    const void *data,
+			    const std::size_t size,
+			    const uint64_t offset);
 
 			/**
 			 * @brief
-			 * Write template data to disk.
+			 * Derive a random-number engine seed from data.
 			 *
-			 * @param directory
-			 * Directory at which to write `templateData`. The name
-			 * of the file in the directory will be parsed from
-			 * `templateData`.
-			 * @param templateData
-			 * Combined "ELFT" template created in createTemplate().
-			 * @param truncate
-			 * Whether or not to truncate file if it already exists.
+			 * @param seed
+			 * Seed from the configuration file, or a value
+			 * previously returned from this function.
+			 * @param data
+			 * Data the seed should depend on (e.g., a template).
+			 * @param size
+			 * Number of bytes pointed to by `data`.
 			 *
 			 * @return
-			 * Status of completing this operation.
+			 * Seed that depends only on `seed` and `data`.
+			 *
+			 * @note
+			 * Keeps no state, so engines seeded with the result
+			 * produce the same values regardless of the order of
+			 * calls or the thread making them.
 			 */
-			ReturnStatus
-			writeTemplate(
-			    const std::filesystem::path &directory,
-			    const std::vector<std::byte> &templateData,
-			    const bool truncate = true);
+			uint64_t
+			deriveSeed(
+			    const uint64_t seed,
+			    const std::byte *data,
+			    const std::size_t size);
+
+			/**
+			 * @brief
+			 * Derive a random-number engine seed from text.
+			 *
+			 * @param seed
+			 * Seed from the configuration file, or a value
+			 * previously returned from this function.
+			 * @param data
+			 * Text the seed should depend on (e.g., an identifier).
+			 *
+			 * @return
+			 * Seed that depends only on `seed` and `data`.
+			 */
+			uint64_t
+			deriveSeed(
+			    const uint64_t seed,
+			    const std::string_view data);
+
+			/**
+			 * @brief
+			 * Scramble the bits of an integer (SplitMix64).
+			 *
+			 * @param x
+			 * Value to scramble.
+			 *
+			 * @return
+			 * Scrambled value. Nearby values of `x` produce
+			 * unrelated results.
+			 */
+			uint64_t
+			mix(
+			    uint64_t x);
+
+			/**
+			 * @brief
+			 * Random-number engine whose n-th value depends only on
+			 * its key and n.
+			 *
+			 * @details
+			 * Values are SplitMix64 outputs of a counter offset by
+			 * the key. Construction is free, so an engine can be
+			 * made for every value scored, and the value does not
+			 * depend on what was scored before it or on which
+			 * thread scored it.
+			 */
+			class CounterEngine
+			{
+			public:
+				/** Type of values returned. */
+				using result_type = uint64_t;
+
+				/**
+				 * @brief
+				 * CounterEngine constructor.
+				 *
+				 * @param key
+				 * Determines every value returned (e.g., from
+				 * deriveSeed()).
+				 */
+				CounterEngine(
+				    const uint64_t key);
+
+				/** @return Smallest value returned. */
+				static constexpr result_type
+				min()
+				{
+					return (0);
+				}
+
+				/** @return Largest value returned. */
+				static constexpr result_type
+				max()
+				{
+					return (UINT64_MAX);
+				}
+
+				/** @return Next value. */
+				result_type
+				operator()()
+				    noexcept;
+
+			private:
+				/** Determines every value returned. */
+				const uint64_t key;
+				/** Number of values returned. */
+				uint64_t counter{};
+			};
 
 #ifdef DEBUG
 			/**
@@ -192,6 +469,150 @@ namespace ELFT
 #endif /* DEBUG */
 		}
 
+		/**
+		 * @brief
+		 * Threads that divide a single search() across cores.
+		 *
+		 * @details
+		 * Threads are started once and wait between calls to run().
+		 * Threads do not survive fork(), so every pool's threads are
+		 * stopped while any thread fork()s and started again in both
+		 * processes. A pool is therefore usable in, and destroyed
+		 * normally by, every process fork()ed after its creation,
+		 * without starting threads during run().
+		 */
+		class ScanPool
+		{
+		public:
+			/**
+			 * @brief
+			 * ScanPool constructor.
+			 *
+			 * @param numShards
+			 * Number of shards each call to run() is divided into.
+			 * The calling thread runs one shard, so
+			 * `numShards - 1` threads are started.
+			 */
+			ScanPool(
+			    const unsigned int numShards);
+
+			/**
+			 * @return
+			 * Number of shards each call to run() is divided into.
+			 */
+			unsigned int
+			getNumShards()
+			    const
+			    noexcept;
+
+			/**
+			 * @brief
+			 * Call a function once for each shard, concurrently.
+			 *
+			 * @param fn
+			 * Function called with each shard number in
+			 * `[0, getNumShards())`.
+			 *
+			 * @throw
+			 * The first exception thrown by `fn`, after all shards
+			 * finish.
+			 */
+			void
+			run(
+			    const std::function<void(const unsigned int shard)>
+			        &fn);
+
+			~ScanPool();
+
+			/** @cond SUPPRESS_FROM_DOXYGEN */
+			ScanPool(const ScanPool&) = delete;
+			ScanPool& operator=(const ScanPool&) = delete;
+			/** @endcond */
+
+		private:
+			/**
+			 * @brief
+			 * Start a thread for each shard without one.
+			 *
+			 * @throw std::system_error
+			 * A thread could not be started.
+			 *
+			 * @note
+			 * #runMutex must be held, or run() not yet callable.
+			 */
+			void
+			start();
+
+			/**
+			 * @brief
+			 * Stop and join every thread.
+			 *
+			 * @note
+			 * #runMutex must be held, or run() no longer callable.
+			 */
+			void
+			stop();
+
+			/**
+			 * @brief
+			 * Body of each thread in #threads.
+			 *
+			 * @param shard
+			 * Shard run by this thread in every call to run().
+			 * @param started
+			 * #generation when the thread was started.
+			 */
+			void
+			work(
+			    const unsigned int shard,
+			    const uint64_t started);
+
+			/**
+			 * @brief
+			 * Quiesce every pool before fork(). Registered with
+			 * pthread_atfork().
+			 */
+			static void
+			prepareFork();
+
+			/**
+			 * @brief
+			 * Restart every pool after fork(), in both the parent
+			 * and the child. Registered with pthread_atfork().
+			 */
+			static void
+			finishFork();
+
+			/** Every pool that exists in this process. */
+			static std::vector<ScanPool*> pools;
+			/** Guards #pools, and is held across fork(). */
+			static std::mutex poolsMutex;
+
+			/** Number of shards per call to run(). */
+			const unsigned int numShards;
+
+			/** Serializes calls to run(), and is held across fork(). */
+			std::mutex runMutex{};
+			/** Guards the members shared with #threads. */
+			std::mutex mutex{};
+			/** Signaled when a call to run() starts or finishes. */
+			std::condition_variable changed{};
+			/** Function passed to the current call to run(). */
+			const std::function<void(const unsigned int)>
+			    *task{nullptr};
+			/** Incremented by each call to run(). */
+			uint64_t generation{};
+			/** Threads that have not finished the current call. */
+			unsigned int remaining{};
+			/** First exception thrown by #task. */
+			std::exception_ptr error{};
+			/** Whether #threads should exit. */
+			bool stopping{false};
+
+			/** Threads running shards 1 and up. */
+			std::vector<std::thread> threads{};
+		};
+
 		class ExtractionImplementation : public ExtractionInterface
 		{
 		public:
@@ -231,7 +652,14 @@ namespace ELFT
 			        &configurationDirectory);
 
 		private:
-			mutable std::mt19937_64 rng{};
+			/**
+			 * Seed from the configuration file. Each call seeds its
+			 * own engine from this and its inputs, so concurrent
+			 * calls share no mutable state.
+			 */
+			uint64_t seed{};
+			/** Number of threads used in createReferenceDatabase(). */
+			unsigned int buildThreads{1};
 		};
 
 		class SearchImplementation : public SearchInterface
@@ -261,14 +689,185 @@ namespace ELFT
 			    const
 			    override;
 
+			std::optional<CallMetrics>
+			getLastCallMetrics()
+			    const
+			    override;
+
 			SearchImplementation(
 			    const std::filesystem::path
 			        &configurationDirectory,
 			    const std::filesystem::path &databaseDirectory);
 
+			~SearchImplementation();
+
 		private:
+			/**
+			 * @brief
+			 * Obtain the IndexEntry for an identifier.
+			 *
+			 * @param identifier
+			 * Identifier of a reference template.
+			 *
+			 * @return
+			 * Pointer to the IndexEntry for `identifier` within
+			 * #database, or nullptr if `identifier` is not in the
+			 * reference database.
+			 */
+			const Database::IndexEntry*
+			findReference(
+			    const std::string &identifier)
+			    const;
+
+			/**
+			 * @brief
+			 * Obtain the identifier of a reference template.
+			 *
+			 * @param entry
+			 * IndexEntry within #database.
+			 *
+			 * @return
+			 * View of the identifier within #database.
+			 */
+			std::string_view
+			getIdentifier(
+			    const Database::IndexEntry &entry)
+			    const;
+
+			/**
+			 * @brief
+			 * Obtain the positions of each subtemplate of a
+			 * reference template.
+			 *
+			 * @param entry
+			 * IndexEntry within #database.
+			 *
+			 * @return
+			 * Pointer to IndexEntry#frgpCount positions within
+			 * #database, each stored as a single byte.
+			 */
+			const uint8_t*
+			getFRGPs(
+			    const Database::IndexEntry &entry)
+			    const;
+
+			/**
+			 * @brief
+			 * Obtain the templates for a reference.
+			 *
+			 * @param entry
+			 * IndexEntry within #database.
+			 *
+			 * @return
+			 * View of the reference template within #database.
+			 *
+			 * @throw std::runtime_error
+			 * The stored template is malformed.
+			 */
+			TmplView
+			viewReference(
+			    const Database::IndexEntry &entry)
+			    const;
+
+			/**
+			 * @brief
+			 * Score a probe against a reference.
+			 *
+			 * @param probeKey
+			 * deriveSeed() of #seed and the probe identifier.
+			 * @param entry
+			 * IndexEntry within #database, with at least one
+			 * subtemplate.
+			 *
+			 * @return
+			 * Highest similarity among the reference's
+			 * subtemplates, and the position reported for it.
+			 *
+			 * @note
+			 * The result depends only on #seed, the probe
+			 * identifier, the reference identifier, and the
+			 * reference's positions, so it is the same however
+			 * references are divided between threads.
+			 */
+			std::tuple<double, FrictionRidgeGeneralizedPosition>
+			scoreReference(
+			    const uint64_t probeKey,
+			    const Database::IndexEntry &entry)
+			    const;
+
+			/**
+			 * @brief
+			 * Score a range of references.
+			 *
+			 * @param begin
+			 * Index of the first IndexEntry to score.
+			 * @param end
+			 * One past the index of the last IndexEntry to score.
+			 * @param probeKey
+			 * deriveSeed() of #seed and the probe identifier.
+			 * @param topK
+			 * Where to offer each score, keyed by index.
+			 */
+			void
+			scanReferences(
+			    const uint64_t begin,
+			    const uint64_t end,
+			    const uint64_t probeKey,
+			    TopKAccumulator &topK)
+			    const;
+
+			/**
+			 * @brief
+			 * Record measurements of the calling thread's most
+			 * recent call on this object.
+			 *
+			 * @param metrics
+			 * Measurements to return from getLastCallMetrics().
+			 */
+			void
+			setLastCallMetrics(
+			    CallMetrics metrics)
+			    const;
+
 			const std::filesystem::path databaseDirectory{};
-			mutable std::mt19937_64 rng{};
+			/**
+			 * Seed from the configuration file. Each call seeds its
+			 * own engines from this and its inputs, so concurrent
+			 * calls share no mutable state.
+			 */
+			uint64_t seed{};
+			/** Number of shards each search() is divided into. */
+			unsigned int searchThreads{1};
+
+			/**
+			 * Threads searching shards of the index, when
+			 * #searchThreads is more than 1. Created by load(), and
+			 * restarted by each fork() that follows.
+			 */
+			std::unique_ptr<ScanPool> scanPool{};
+
+			/**
+			 * Measurements of each thread's most recent call on
+			 * this object. One entry per calling thread, released
+			 * with the object.
+			 */
+			mutable std::unordered_map<std::thread::id, CallMetrics>
+			    lastCallMetrics{};
+			/** Guards #lastCallMetrics. */
+			mutable std::mutex lastCallMetricsMutex{};
+
+			/**
+			 * Read-only mapping of the reference database file.
+			 * Never modified once load() returns, so fork()ed
+			 * processes share it.
+			 */
+			const std::byte *database{nullptr};
+			/** Number of bytes mapped at #database. */
+			std::size_t databaseSize{};
+			/** Header at the start of #database. */
+			const Database::Header *header{nullptr};
+			/** First IndexEntry within #database. */
+			const Database::IndexEntry *index{nullptr};
 		};
 	}
 }
@@ -0,0 +1,93 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include <elft_randimpl.h>
+
+namespace
+{
+	/** Number of failed checks. */
+	unsigned int failures{};
+
+	/**
+	 * @brief
+	 * Record the outcome of a check.
+	 *
+	 * @param passed
+	 * Whether the check passed.
+	 * @param description
+	 * What was checked.
+	 */
+	void
+	check(
+	    const bool passed,
+	    const char *description)
+	{
+		if (!passed) {
+			std::cerr << "FAIL: " << description << '\n';
+			++failures;
+		}
+	}
+}
+
+int
+main()
+{
+	using ELFT::RandomImplementation::Util::CounterEngine;
+	using ELFT::RandomImplementation::Util::deriveSeed;
+
+	/*
+	 * Fixed values, so that scores do not change between builds or
+	 * platforms. CounterEngine{0} is the reference SplitMix64 sequence.
+	 */
+	check(deriveSeed(0, "") == 0xF52A15E9A9B5E89Bull,
+	    "deriveSeed() of nothing");
+	check(deriveSeed(42, "abc") == 0x9833F1986F525F72ull,
+	    "deriveSeed() of an identifier");
+	CounterEngine reference{0};
+	check(reference() == 0xE220A8397B1DCDAFull,
+	    "CounterEngine first output");
+	check(reference() == 0x6E789E6AA1B965F4ull,
+	    "CounterEngine second output");
+	check(reference() == 0x06C45D188009454Full,
+	    "CounterEngine third output");
+
+	/* Byte and string overloads agree; seed and data both matter */
+	const std::byte abc[]{std::byte{'a'}, std::byte{'b'}, std::byte{'c'}};
+	check(deriveSeed(42, abc, sizeof(abc)) == deriveSeed(42, "abc"),
+	    "deriveSeed() overloads agree");
+	check(deriveSeed(43, "abc") != deriveSeed(42, "abc"),
+	    "deriveSeed() depends on the seed");
+	check(deriveSeed(42, "abd") != deriveSeed(42, "abc"),
+	    "deriveSeed() depends on the data");
+
+	/* Same key gives the same sequence, regardless of thread */
+	uint64_t fromThread{};
+	std::thread{[&fromThread]() {
+		CounterEngine engine{deriveSeed(7, "probe")};
+		std::uniform_real_distribution<double> d{};
+		for (unsigned int i{}; i < 100; ++i)
+			d(engine);
+		fromThread = engine();
+	}}.join();
+	CounterEngine engine{deriveSeed(7, "probe")};
+	std::uniform_real_distribution<double> d{};
+	for (unsigned int i{}; i < 100; ++i)
+		d(engine);
+	check(engine() == fromThread, "CounterEngine is reproducible");
+
+	if (failures != 0)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
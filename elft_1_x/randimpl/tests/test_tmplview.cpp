@@ -0,0 +1,133 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <cstdlib>
+#include <initializer_list>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <elft_randimpl.h>
+
+namespace
+{
+	/** Number of failed checks. */
+	unsigned int failures{};
+
+	/**
+	 * @brief
+	 * Record the outcome of a check.
+	 *
+	 * @param passed
+	 * Whether the check passed.
+	 * @param description
+	 * What was checked.
+	 */
+	void
+	check(
+	    const bool passed,
+	    const char *description)
+	{
+		if (!passed) {
+			std::cerr << "FAIL: " << description << '\n';
+			++failures;
+		}
+	}
+
+	/**
+	 * @return
+	 * `bytes` as a template.
+	 */
+	std::vector<std::byte>
+	bytes(
+	    const std::initializer_list<int> bytes)
+	{
+		std::vector<std::byte> b{};
+		for (const auto &c : bytes)
+			b.push_back(static_cast<std::byte>(c));
+		return (b);
+	}
+
+	/**
+	 * @return
+	 * Whether constructing a TmplView of `data` throws
+	 * std::runtime_error.
+	 */
+	bool
+	rejects(
+	    const std::vector<std::byte> &data)
+	{
+		try {
+			const ELFT::RandomImplementation::TmplView view{
+			    data.data(), data.size()};
+		} catch (const std::runtime_error&) {
+			return (true);
+		}
+		return (false);
+	}
+}
+
+int
+main()
+{
+	using ELFT::RandomImplementation::TmplView;
+
+	/* "ab", then two subtemplates of 2 and 0 bytes */
+	const auto valid = bytes({'a', 'b', 0, 1, 2, 2, 7, 8, 3, 4, 0});
+	try {
+		const TmplView view{valid.data(), valid.size()};
+		check(view.getIdentifier() == "ab",
+		    "getIdentifier() stops at the terminator");
+
+		std::vector<TmplView::Subtemplate> subtemplates{};
+		for (const auto &subtemplate : view)
+			subtemplates.push_back(subtemplate);
+		check(subtemplates.size() == 2, "iterates every subtemplate");
+		check((subtemplates.size() == 2) &&
+		    (subtemplates[0].inputIdentifier == 1) &&
+		    (subtemplates[0].frgp ==
+		    ELFT::FrictionRidgeGeneralizedPosition::RightIndex) &&
+		    (subtemplates[0].size == 2) &&
+		    (subtemplates[0].data == valid.data() + 6) &&
+		    (subtemplates[1].inputIdentifier == 3) &&
+		    (subtemplates[1].size == 0),
+		    "subtemplate fields are read in place");
+
+		const auto parsed = ELFT::RandomImplementation::Util::
+		    parseTemplate(valid);
+		check((parsed.size() == 2) &&
+		    (parsed[0].candidateIdentifier == "ab") &&
+		    (parsed[1].inputIdentifier == 3),
+		    "parseTemplate() agrees with TmplView");
+	} catch (const std::exception &e) {
+		std::cerr << "FAIL: valid template: " << e.what() << '\n';
+		++failures;
+	}
+
+	check(rejects(bytes({})), "rejects an empty template");
+	check(rejects(bytes({'a', 'b'})),
+	    "rejects an unterminated identifier");
+	check(rejects(bytes({'a', 0})), "rejects no subtemplates");
+	check(rejects(bytes({'a', 0, 1, 2})),
+	    "rejects a truncated subtemplate header");
+	check(rejects(bytes({'a', 0, 1, 2, 3, 7, 8})),
+	    "rejects truncated subtemplate data");
+	check(rejects(bytes({'a', 0, 1, 2, 1, 7, 1, 2, 255})),
+	    "rejects a truncated second subtemplate");
+
+	/* Never reads past the end when the terminator is missing */
+	const auto padded = bytes({'a', 0, 1, 2, 0});
+	check(rejects({padded.cbegin(), padded.cbegin() + 1}),
+	    "rejects a terminator beyond the template");
+
+	if (failures != 0)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
@@ -8,30 +8,130 @@
  * about its quality, reliability, or any other characteristic.
  */
 
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 
+#include <fcntl.h>
 #include <getopt.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <exception>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <mutex>
+#include <new>
 #include <sstream>
 #include <system_error>
 #include <thread>
 #include <variant>
 
 #include <elft.h>
+#include <elft_archive.h>
 #include <elft_validation.h>
 #include <elft_validation_data.h>
+#include <elft_validation_perf.h>
+#include <elft_validation_trace.h>
 #include <elft_validation_utils.h>
 
+namespace
+{
+	/** Number of the calling thread, when running multiple threads. */
+	thread_local std::optional<uint16_t> workerThread{};
+
+	/** Event counters for the calling worker, when requested (-P). */
+	thread_local std::unique_ptr<ELFT::Validation::PerformanceCounters>
+	    workerCounters{};
+	/** Events counted during each call made by the calling worker. */
+	thread_local std::ofstream workerCounterLog{};
+}
+
+bool
+ELFT::Validation::copyAt(
+    const int sourceFD,
+    const uint64_t sourceOffset,
+    const uint64_t size,
+    const int fd,
+    const uint64_t offset)
+{
+	/* Let the kernel move the bytes when the filesystem allows it */
+	loff_t inOffset{static_cast<loff_t>(sourceOffset)};
+	loff_t outOffset{static_cast<loff_t>(offset)};
+	uint64_t copied{};
+	while (copied < size) {
+		const auto rv = ::copy_file_range(sourceFD, &inOffset, fd,
+		    &outOffset, static_cast<std::size_t>(size - copied), 0);
+		if (rv == -1) {
+			if (errno == EINTR)
+				continue;
+			/* Fall back to copying through a buffer below */
+			if ((errno == EXDEV) || (errno == ENOSYS) ||
+			    (errno == EINVAL) || (errno == EOPNOTSUPP))
+				break;
+			return (false);
+		}
+		/* Unexpected end of file */
+		if (rv == 0)
+			return (false);
+		copied += static_cast<uint64_t>(rv);
+	}
+
+	static constexpr uint64_t maxBufferSize{8 * 1024 * 1024};
+	std::vector<char> buffer{};
+	while (copied < size) {
+		buffer.resize(static_cast<std::size_t>(std::min(size - copied,
+		    maxBufferSize)));
+		const auto rv = ::pread(sourceFD, buffer.data(), buffer.size(),
+		    static_cast<off_t>(sourceOffset + copied));
+		if ((rv == -1) && (errno == EINTR))
+			continue;
+		if (rv <= 0)
+			return (false);
+
+		std::size_t written{};
+		while (written < static_cast<std::size_t>(rv)) {
+			const auto wv = ::pwrite(fd, buffer.data() + written,
+			    static_cast<std::size_t>(rv) - written,
+			    static_cast<off_t>(offset + copied + written));
+			if ((wv == -1) && (errno == EINTR))
+				continue;
+			if (wv <= 0)
+				return (false);
+			written += static_cast<std::size_t>(wv);
+		}
+		copied += written;
+	}
+
+	return (true);
+}
+
+void
+ELFT::Validation::copyFileAt(
+    const std::filesystem::path &source,
+    const uint64_t size,
+    const int fd,
+    const uint64_t offset)
+{
+	const int sourceFD{::open(source.c_str(), O_RDONLY)};
+	if (sourceFD == -1)
+		throw std::runtime_error{"Could not open " + source.string()};
+
+	const bool copied{copyAt(sourceFD, 0, size, fd, offset)};
+	::close(sourceFD);
+	if (!copied)
+		throw std::runtime_error{"Could not copy " + source.string()};
+}
+
 int
 ELFT::Validation::dispatchOperation(
     const ELFT::Validation::Arguments &args)
@@ -81,9 +181,7 @@ ELFT::Validation::dispatchOperation(
 		break;
 	case Operation::CreateReferenceDatabase:
 		try {
-			const auto impl = ELFT::ExtractionInterface::
-			    getImplementation(args.configDir);
-			rv = runCreateReferenceDatabase(impl, args);
+			rv = runCreateReferenceDatabase(args);
 		} catch (const std::exception &e) {
 			std::cerr << "CreateReferenceDatabase: " << e.what() <<
 			    '\n';
@@ -94,7 +192,10 @@ ELFT::Validation::dispatchOperation(
 		break;
 	case Operation::Search:
 		try {
-			testOperation(args);
+			if (args.loadSizeSweep.empty())
+				testOperation(args);
+			else
+				runLoadSizeSweep(args);
 			rv = EXIT_SUCCESS;
 		} catch (const std::exception &e) {
 			std::cerr << "Search: " << e.what() << '\n';
@@ -107,6 +208,70 @@ ELFT::Validation::dispatchOperation(
 	return (rv);
 }
 
+std::chrono::milliseconds
+ELFT::Validation::getCreateTemplateTimeLimit(
+    const Data::ImageSet &imageSet,
+    const TemplateType templateType)
+{
+	std::chrono::milliseconds limit{};
+	for (const auto &md : std::get<1>(imageSet)) {
+		/* N */
+		std::chrono::milliseconds n{};
+		if (!md.filename)
+			n = std::chrono::milliseconds{2500};
+		else if ((md.efs && (md.efs->imp == Impression::Latent)) ||
+		    (!md.efs && (templateType == TemplateType::Probe)))
+			n = std::chrono::milliseconds{20000};
+		else
+			n = std::chrono::milliseconds{5000};
+
+		/* M */
+		std::chrono::milliseconds::rep m{1};
+		if (md.efs) {
+			switch (md.efs->frgp) {
+			case FrictionRidgeGeneralizedPosition::UnknownFinger:
+			case FrictionRidgeGeneralizedPosition::RightThumb:
+			case FrictionRidgeGeneralizedPosition::RightIndex:
+			case FrictionRidgeGeneralizedPosition::RightMiddle:
+			case FrictionRidgeGeneralizedPosition::RightRing:
+			case FrictionRidgeGeneralizedPosition::RightLittle:
+			case FrictionRidgeGeneralizedPosition::LeftThumb:
+			case FrictionRidgeGeneralizedPosition::LeftIndex:
+			case FrictionRidgeGeneralizedPosition::LeftMiddle:
+			case FrictionRidgeGeneralizedPosition::LeftRing:
+			case FrictionRidgeGeneralizedPosition::LeftLittle:
+			case FrictionRidgeGeneralizedPosition::RightExtraDigit:
+			case FrictionRidgeGeneralizedPosition::LeftExtraDigit:
+				m = 1;
+				break;
+			case FrictionRidgeGeneralizedPosition::
+			    RightAndLeftThumbs:
+				m = 2;
+				break;
+			case FrictionRidgeGeneralizedPosition::RightFour:
+			case FrictionRidgeGeneralizedPosition::LeftFour:
+				m = 4;
+				break;
+			case FrictionRidgeGeneralizedPosition::RightFullPalm:
+			case FrictionRidgeGeneralizedPosition::LeftFullPalm:
+			case FrictionRidgeGeneralizedPosition::
+			    RightFullPalmAndWritersPalm:
+			case FrictionRidgeGeneralizedPosition::
+			    LeftFullPalmAndWritersPalm:
+				m = 16;
+				break;
+			default:
+				m = 8;
+				break;
+			}
+		}
+
+		limit += n * m;
+	}
+
+	return (limit);
+}
+
 std::string
 ELFT::Validation::getExtractionInterfaceIdentificationString(
     const Arguments &args)
@@ -212,6 +377,38 @@ ELFT::Validation::getImageSet(
 	}
 }
 
+std::string
+ELFT::Validation::getOperationName(
+    const Arguments &args)
+{
+	switch (args.operation.value()) {
+	case Operation::Extract:
+		return ("extraction-" + e2i2s(*args.templateType));
+	case Operation::CreateReferenceDatabase:
+		return ("createReferenceDatabase");
+	case Operation::Search:
+		return ("search");
+	default:
+		throw std::runtime_error("Unsupported operation was sent to "
+		    "getOperationName()");
+	}
+}
+
+uint64_t
+ELFT::Validation::getPeakResidentSetSize(
+    const bool children)
+{
+	struct rusage usage{};
+	if (::getrusage(children ? RUSAGE_CHILDREN : RUSAGE_SELF,
+	    &usage) != 0)
+		throw std::runtime_error{"Could not obtain resource usage: " +
+		    std::system_error(errno, std::system_category()).code().
+		    message()};
+
+	/* Linux reports ru_maxrss in KiB */
+	return (static_cast<uint64_t>(std::max(usage.ru_maxrss, 0L)));
+}
+
 std::string
 ELFT::Validation::getSearchInterfaceIdentificationString(
     const Arguments &args)
@@ -250,6 +447,17 @@ ELFT::Validation::getSearchInterfaceIdentificationString(
 	return (ss.str());
 }
 
+ELFT::TemplateArchive
+ELFT::Validation::getTemplateArchiveSegment(
+    const Arguments &args,
+    const std::string &worker)
+{
+	const auto dir = args.outputDir / Data::getTemplateDir(
+	    TemplateType::Reference);
+	return {dir / (Data::TemplateArchiveArchiveName + '-' + worker),
+	    dir / (Data::TemplateArchiveManifestName + '-' + worker)};
+}
+
 std::string
 ELFT::Validation::getUsageString(
     const std::string &name)
@@ -266,13 +474,15 @@ ELFT::Validation::getUsageString(
 
 	ss << prefix << "# createTemplate() + extractTemplateData()\n" <<
 	    prefix << "-e <probe|reference> -z <configDir> [-o <outputDir>] "
-	   "[-a image_dir]\n" << prefix << "[-r random_seed] [-f num_procs]\n";
+	   "[-a image_dir]\n" << prefix << "[-r random_seed] [-f num_procs] "
+	    "[-T num_threads]\n" << prefix << "[-L] [-P] [-x] "
+	    "[-A (reference only)]\n";
 
 	ss << '\n';
 
 	ss << prefix << "# createReferenceDatabase()\n" << prefix <<
 	    "-c -d <referenceDir> -z <configDir> [-o <outputDir>] "
-	    "[-m max_size]\n";
+	    "[-m max_size] [-x]\n";
 
 	ss << '\n';
 
@@ -284,16 +494,51 @@ ELFT::Validation::getUsageString(
 	ss << prefix << "# search() + extractCorrespondence()\n" << prefix <<
 	    "-s -d <referenceDir> -z <configDir> [-o <outputDir>] "
 	    "[-r random_seed]\n" << prefix <<
-	    "[-m max_candidates] [-f num_procs]\n";
+	    "[-m max_candidates] [-f num_procs] [-T num_threads] [-P] "
+	    "[-x]\n" <<
+	    prefix << "[-M load_size | -W load_size,load_size,...]\n";
 
 	ss << '\n';
 
 	ss << prefix << "# Database modification operations\n" << prefix <<
-	    "-t -d <referenceDir> -z <configDir> [-o <outputDir>]";
+	    "-t -d <referenceDir> -z <configDir> [-o <outputDir>]\n";
+
+	ss << '\n';
+
+	ss << prefix << "# -P counts only the thread making each call and "
+	    "threads it\n" << prefix << "# creates that exit before the call "
+	    "returns. Threads that\n" << prefix << "# outlive calls, such as "
+	    "a pool started by load(), are\n" << prefix << "# not counted.";
 
 	return (ss.str());
 }
 
+std::string
+ELFT::Validation::getWorkerIdentifier()
+{
+	if (workerThread)
+		return (ts(getpid()) + '-' + ts(*workerThread));
+	return (ts(getpid()));
+}
+
+ELFT::Validation::IndexQueue::IndexQueue(
+    const std::vector<uint64_t> &indicies,
+    std::atomic<uint64_t> &position) :
+    indicies{indicies},
+    position{position}
+{
+
+}
+
+std::optional<uint64_t>
+ELFT::Validation::IndexQueue::next()
+{
+	const auto i = this->position.fetch_add(1);
+	if (i >= this->indicies.size())
+		return (std::nullopt);
+	return (this->indicies[i]);
+}
+
 void
 ELFT::Validation::makeReferenceTemplateArchive(
     const ELFT::Validation::Arguments &args)
@@ -305,13 +550,6 @@ ELFT::Validation::makeReferenceTemplateArchive(
 		throw std::runtime_error{
 		    (dir / Data::TemplateArchiveArchiveName).string() + " "
 		        "already exists"};
-	std::ofstream archive{dir / Data::TemplateArchiveArchiveName,
-	    std::ios_base::out | std::ios_base::binary |
-	    std::ios_base::app};
-	if (!archive)
-		throw std::runtime_error{"Could not open " +
-		    (dir / Data::TemplateArchiveArchiveName).string()};
-
 	if (std::filesystem::exists(dir / Data::TemplateArchiveManifestName))
 		throw std::runtime_error{
 		    (dir / Data::TemplateArchiveManifestName).string() + " "
@@ -335,64 +573,234 @@ ELFT::Validation::makeReferenceTemplateArchive(
 	}
 	std::sort(entries.begin(), entries.end());
 
-	for (const auto &entry : entries) {
-		std::ifstream tmpl{entry.path(), std::ios_base::in |
-		    std::ios_base::binary | std::ios_base::ate};
-		if (!tmpl)
+	/*
+	 * Assign every template its place in the archive before copying, so
+	 * the archive is identical no matter which thread copies what.
+	 */
+	std::vector<uint64_t> sizes(entries.size());
+	std::vector<uint64_t> offsets(entries.size());
+	uint64_t archiveSize{};
+	for (std::vector<uint64_t>::size_type i{}; i < entries.size(); ++i) {
+		sizes[i] = entries[i].file_size();
+		offsets[i] = archiveSize;
+		archiveSize += sizes[i];
+
+		manifest << entries[i].path().filename().replace_extension().
+		    string() << ' ' << sizes[i] << ' ' << offsets[i] << '\n';
+	}
+	if (!manifest)
+		throw std::runtime_error{"Could not write " +
+		    (dir / Data::TemplateArchiveManifestName).string()};
+
+	const auto archivePath = dir / Data::TemplateArchiveArchiveName;
+	const int archive{::open(archivePath.c_str(),
+	    O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP |
+	    S_IROTH)};
+	if (archive == -1)
+		throw std::runtime_error{"Could not open " +
+		    archivePath.string()};
+	if (::ftruncate(archive, static_cast<off_t>(archiveSize)) != 0) {
+		::close(archive);
+		throw std::runtime_error{"Could not size " +
+		    archivePath.string()};
+	}
+
+	try {
+		parallelFor(entries.size(), [&](const uint64_t i) {
+			copyFileAt(entries[i].path(), sizes[i], archive,
+			    offsets[i]);
+		});
+	} catch (...) {
+		::close(archive);
+		throw;
+	}
+
+	if (::close(archive) != 0)
+		throw std::runtime_error{"Could not close " +
+		    archivePath.string()};
+}
+
+void
+ELFT::Validation::mergeTemplateArchiveSegments(
+    const ELFT::Validation::Arguments &args)
+{
+	const auto dir = args.outputDir / Data::getTemplateDir(
+	    TemplateType::Reference);
+
+	const auto archivePath = dir / Data::TemplateArchiveArchiveName;
+	const auto manifestPath = dir / Data::TemplateArchiveManifestName;
+	if (std::filesystem::exists(archivePath))
+		throw std::runtime_error{archivePath.string() + " already "
+		    "exists"};
+	if (std::filesystem::exists(manifestPath))
+		throw std::runtime_error{manifestPath.string() + " already "
+		    "exists"};
+
+	/* Find the segment written by each worker */
+	const std::string manifestPrefix{Data::TemplateArchiveManifestName +
+	    '-'};
+	std::vector<TemplateArchive> segmentPaths{};
+	for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+		const auto filename = entry.path().filename().string();
+		if (filename.compare(0, manifestPrefix.length(),
+		    manifestPrefix) != 0)
+			continue;
+		segmentPaths.push_back(getTemplateArchiveSegment(args,
+		    filename.substr(manifestPrefix.length())));
+	}
+
+	std::vector<std::unique_ptr<TemplateArchiveManifest>> segments{};
+	for (const auto &segment : segmentPaths)
+		segments.push_back(std::make_unique<TemplateArchiveManifest>(
+		    segment.manifest));
+
+	/*
+	 * Sort the same way makeReferenceTemplateArchive() sorts template
+	 * files, so both produce identical archives.
+	 */
+	struct Location
+	{
+		std::string key{};
+		std::vector<TemplateArchive>::size_type segment{};
+		const TemplateArchiveManifest::Entry *entry{};
+	};
+	std::vector<Location> locations{};
+	for (std::vector<TemplateArchive>::size_type i{};
+	    i < segments.size(); ++i)
+		for (const auto &entry : segments[i]->getEntries())
+			locations.push_back({std::string(segments[i]->
+			    getIdentifier(entry)) + Data::TemplateSuffix, i,
+			    &entry});
+	std::sort(locations.begin(), locations.end(),
+	    [](const Location &lhs, const Location &rhs) -> bool {
+		return (lhs.key < rhs.key);
+	});
+
+	std::ofstream manifest{manifestPath, std::ios_base::out |
+	    std::ios_base::binary | std::ios_base::app};
+	if (!manifest)
+		throw std::runtime_error{"Could not open " +
+		    manifestPath.string()};
+
+	std::vector<uint64_t> offsets(locations.size());
+	uint64_t archiveSize{};
+	for (std::vector<Location>::size_type i{}; i < locations.size(); ++i) {
+		offsets[i] = archiveSize;
+		archiveSize += locations[i].entry->length;
+
+		manifest << segments[locations[i].segment]->getIdentifier(
+		    *locations[i].entry) << ' ' << locations[i].entry->length <<
+		    ' ' << offsets[i] << '\n';
+	}
+	if (!manifest)
+		throw std::runtime_error{"Could not write " +
+		    manifestPath.string()};
+
+	const int archive{::open(archivePath.c_str(),
+	    O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP |
+	    S_IROTH)};
+	if (archive == -1)
+		throw std::runtime_error{"Could not open " +
+		    archivePath.string()};
+	std::vector<int> segmentFDs{};
+	const auto closeAll = [&]() {
+		::close(archive);
+		for (const auto &fd : segmentFDs)
+			::close(fd);
+	};
+	if (::ftruncate(archive, static_cast<off_t>(archiveSize)) != 0) {
+		closeAll();
+		throw std::runtime_error{"Could not size " +
+		    archivePath.string()};
+	}
+	for (const auto &segment : segmentPaths) {
+		segmentFDs.push_back(::open(segment.archive.c_str(),
+		    O_RDONLY));
+		if (segmentFDs.back() == -1) {
+			segmentFDs.pop_back();
+			closeAll();
 			throw std::runtime_error{"Could not open " +
-			    entry.path().string()};
-
-		const auto tmplDataSize = tmpl.tellg();
-		if (!tmpl)
-			throw std::runtime_error{"Could not get size of " +
-			    entry.path().string()};
-
-		tmpl.seekg(0);
-		if (!tmpl)
-			throw std::runtime_error{"Could not rewind " +
-			    entry.path().string()};
-
-		std::vector<std::byte> tmplData(
-		    static_cast<std::vector<std::byte>::size_type>(
-		    tmplDataSize));
-		tmpl.read(reinterpret_cast<char*>(tmplData.data()),
-		    tmplDataSize);
-		if (!tmpl)
-			throw std::runtime_error{"Could not read " +
-			    entry.path().string()};
-
-		const auto currentOffset = archive.tellp();
-		if (!archive)
-			throw std::runtime_error{"Could not get current "
-			    "offset from " +
-			    (dir / Data::TemplateArchiveArchiveName).string()};
-
-		archive.write(reinterpret_cast<char*>(tmplData.data()),
-		    tmplDataSize);
-		if (!archive)
-			throw std::runtime_error{"Could not write " +
-			    (dir / Data::TemplateArchiveArchiveName).string()};
-
-		manifest << entry.path().filename().replace_extension().
-		    string() << ' ' << tmplDataSize << ' ' << currentOffset <<
-		    '\n';
-		if (!manifest)
-			throw std::runtime_error{"Could not write " +
-			    (dir / Data::TemplateArchiveManifestName).string()};
+			    segment.archive.string()};
+		}
+	}
+
+	try {
+		parallelFor(locations.size(), [&](const uint64_t i) {
+			const auto &location = locations[i];
+			if (!copyAt(segmentFDs[location.segment],
+			    location.entry->offset, location.entry->length,
+			    archive, offsets[i]))
+				throw std::runtime_error{"Could not copy " +
+				    location.key + " from " +
+				    segmentPaths[location.segment].archive.
+				    string()};
+		});
+	} catch (...) {
+		closeAll();
+		throw;
+	}
+
+	for (const auto &fd : segmentFDs)
+		::close(fd);
+	if (::close(archive) != 0)
+		throw std::runtime_error{"Could not close " +
+		    archivePath.string()};
+
+	for (const auto &segment : segmentPaths) {
+		std::filesystem::remove(segment.archive);
+		std::filesystem::remove(segment.manifest);
 	}
 }
 
+void
+ELFT::Validation::parallelFor(
+    const uint64_t count,
+    const std::function<void(const uint64_t)> &fn)
+{
+	/* Threads claim one item at a time */
+	std::atomic<uint64_t> next{0};
+	std::exception_ptr error{};
+	std::mutex errorMutex{};
+	const auto worker = [&]() {
+		try {
+			for (auto i = next++; i < count; i = next++)
+				fn(i);
+		} catch (...) {
+			const std::lock_guard<std::mutex> lock{errorMutex};
+			if (!error)
+				error = std::current_exception();
+			next = count;
+		}
+	};
+
+	const auto numThreads = std::min<uint64_t>(
+	    std::max(1u, std::thread::hardware_concurrency()), count);
+	std::vector<std::thread> threads{};
+	for (uint64_t i{1}; i < numThreads; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for (auto &thread : threads)
+		thread.join();
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
 ELFT::Validation::Arguments
 ELFT::Validation::parseArguments(
     const int argc,
     char * const argv[])
 {
-	static const char options[] {"a:cd:e:f:ijm:o:r:sz:"};
+	static const char options[] {"ALM:PT:W:a:cd:e:f:ijm:o:r:sxz:"};
 	Validation::Arguments args{};
+	bool loadSizeSpecified{false};
 
 	int c{};
 	while ((c = getopt(argc, argv, options)) != -1) {
 		switch (c) {
+		case 'A':	/* Stream references to template archive */
+			args.streamArchive = true;
+			break;
 		case 'a':	/* Image directory */
 			args.imageDir = optarg;
 			break;
@@ -446,6 +854,61 @@ ELFT::Validation::parseArguments(
 				    "refusing"};
 			break;
 		}
+		case 'L':	/* Longest extractions first */
+			args.longestFirst = true;
+			break;
+		case 'M':	/* Memory budget for load() */
+			try {
+				/* std::stoull() would wrap negative values */
+				if (std::strchr(optarg, '-') != nullptr)
+					throw std::invalid_argument{"negative"};
+				args.loadSize = std::stoull(optarg);
+			} catch (const std::exception&) {
+				throw std::invalid_argument{"Load size (-M): "
+				    "an error occurred when parsing \"" +
+				    std::string(optarg) + "\""};
+			}
+			loadSizeSpecified = true;
+			break;
+		case 'P':	/* Hardware event counters */
+			args.perfCounters = true;
+			break;
+		case 'W': {	/* Sweep of memory budgets for load() */
+			std::stringstream list{optarg};
+			std::string size{};
+			while (std::getline(list, size, ',')) {
+				try {
+					if (size.find('-') != std::string::npos)
+						throw std::invalid_argument{
+						    "negative"};
+					args.loadSizeSweep.push_back(
+					    std::stoull(size));
+				} catch (const std::exception&) {
+					throw std::invalid_argument{"Load size "
+					    "sweep (-W): an error occurred when "
+					    "parsing \"" + size + "\""};
+				}
+			}
+			if (args.loadSizeSweep.empty())
+				throw std::invalid_argument{"Load size sweep "
+				    "(-W): no sizes provided"};
+			break;
+		}
+		case 'T': {	/* Number of threads */
+			try {
+				args.numThreads = static_cast<uint16_t>(
+				    std::stoul(optarg));
+			} catch (const std::exception&) {
+				throw std::invalid_argument{"Number of "
+				    "threads (-T): an error occurred when "
+				    "parsing \"" + std::string(optarg) + "\""};
+			}
+
+			if (args.numThreads == 0)
+				throw std::invalid_argument{"Number of "
+				    "threads (-T): must be at least 1"};
+			break;
+		}
 		case 'i':	/* ExtractionInterface identification */
 			if (args.operation)
 				throw std::logic_error{"Multiple operations "
@@ -485,6 +948,9 @@ ELFT::Validation::parseArguments(
 				    "specified"};
 			args.operation = Operation::Search;
 			break;
+		case 'x':	/* Trace */
+			args.trace = true;
+			break;
 		case 'z':	/* Config dir */
 			args.configDir = optarg;
 			break;
@@ -505,6 +971,36 @@ ELFT::Validation::parseArguments(
 		throw std::invalid_argument{"Must provide path to reference "
 		    "database"};
 
+	if (args.streamArchive && ((args.operation != Operation::Extract) ||
+	    (args.templateType != TemplateType::Reference)))
+		throw std::invalid_argument{"Streaming to template archive "
+		    "(-A) is only supported when extracting references"};
+
+	if (args.longestFirst && (args.operation != Operation::Extract))
+		throw std::invalid_argument{"Longest processing time first "
+		    "(-L) is only supported when extracting"};
+
+	if (args.trace && (args.operation != Operation::Extract) &&
+	    (args.operation != Operation::CreateReferenceDatabase) &&
+	    (args.operation != Operation::Search))
+		throw std::invalid_argument{"Tracing (-x) is only supported "
+		    "when extracting, creating a reference database, or "
+		    "searching"};
+
+	if (args.perfCounters && (args.operation != Operation::Extract) &&
+	    (args.operation != Operation::Search))
+		throw std::invalid_argument{"Hardware event counters (-P) are "
+		    "only supported when extracting or searching"};
+
+	if ((loadSizeSpecified || !args.loadSizeSweep.empty()) &&
+	    (args.operation != Operation::Search))
+		throw std::invalid_argument{"Load size (-M, -W) is only "
+		    "supported when searching"};
+
+	if (loadSizeSpecified && !args.loadSizeSweep.empty())
+		throw std::invalid_argument{"Load size (-M) and load size "
+		    "sweep (-W) are mutually exclusive"};
+
 	if (args.maximum == 0) {
 		if (args.operation == Operation::CreateReferenceDatabase)
 			args.maximum = 100000000;
@@ -530,6 +1026,32 @@ ELFT::Validation::randomizeIndicies(
 	return (indicies);
 }
 
+std::string
+ELFT::Validation::recordCallMetrics(
+    const std::optional<CallMetrics> &metrics,
+    const std::string &operation,
+    LatencyRecorder &latencies)
+{
+	if (!metrics || (metrics->stages.empty() &&
+	    metrics->counters.empty()))
+		return (NA);
+
+	std::string column{};
+	for (const auto &[name, microseconds] : metrics->stages) {
+		latencies.record(operation + " stage=" + name,
+		    std::chrono::microseconds{microseconds});
+		column += name + '=' + ts(microseconds) + "us;";
+	}
+	for (const auto &[name, value] : metrics->counters) {
+		std::stringstream ss{};
+		ss << name << '=' << value << ';';
+		column += ss.str();
+	}
+	column.pop_back();
+
+	return (sanitizeMessage(column));
+}
+
 std::vector<std::byte>
 ELFT::Validation::readFile(
     const std::filesystem::path &pathName)
@@ -561,9 +1083,22 @@ ELFT::Validation::readFile(
 
 int
 ELFT::Validation::runCreateReferenceDatabase(
-    std::shared_ptr<ExtractionInterface> impl,
     const Arguments &args)
 {
+	if (args.trace)
+		enableTracing();
+
+	LatencyRecorder latencies{};
+	std::chrono::steady_clock::time_point start{}, stop{};
+
+	start = std::chrono::steady_clock::now();
+	const auto impl = ELFT::ExtractionInterface::getImplementation(
+	    args.configDir);
+	stop = std::chrono::steady_clock::now();
+	recordTraceSpan("getImplementation", "api", start, stop);
+	latencies.record("getImplementation", stop - start,
+	    std::chrono::seconds{5});
+
 	std::filesystem::create_directories(args.dbDir);
 	std::filesystem::permissions(args.dbDir,
 	    std::filesystem::perms::owner_all |
@@ -579,13 +1114,19 @@ ELFT::Validation::runCreateReferenceDatabase(
 		    "exist"};
 	TemplateArchive referenceTemplates{archivePath, manifestPath};
 
+	/* Time limit is per line of the manifest */
+	const auto manifestLines = TemplateArchiveManifest(manifestPath).size();
+
 	ReturnStatus rs{};
-	std::chrono::steady_clock::time_point start{}, stop{};
 	try {
 		start = std::chrono::steady_clock::now();
 		rs = impl->createReferenceDatabase(referenceTemplates,
 		    args.dbDir, args.maximum);
 		stop = std::chrono::steady_clock::now();
+		recordTraceSpan("createReferenceDatabase", "api", start,
+		    stop);
+		latencies.record("createReferenceDatabase", stop - start,
+		    std::chrono::milliseconds{10} * manifestLines);
 	} catch (const std::exception &e) {
 		throw std::runtime_error("Exception while creating reference "
 		    "database (" + std::string(e.what()) + ")");
@@ -597,8 +1138,8 @@ ELFT::Validation::runCreateReferenceDatabase(
 	const std::string logName{"createReferenceDatabase.log"};
 	std::ofstream file{args.outputDir / logName};
 	if (!file)
-		throw std::runtime_error(ts(getpid()) + ": Error creating log "
-		    "file");
+		throw std::runtime_error(getWorkerIdentifier() +
+		    ": Error creating log file");
 
 	static const std::string header{"elapsed,result,\"message\",max_size"};
 	file << header << '\n';
@@ -611,14 +1152,18 @@ ELFT::Validation::runCreateReferenceDatabase(
 	if (!file)
 		throw std::runtime_error("Error writing to log");
 
+	summarizeLatencies(args, stop - start, latencies);
+	summarizeTrace(args);
+
 	return (rs ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
-void
+std::vector<uint64_t>
 ELFT::Validation::runExtractionCreate(
     std::shared_ptr<ExtractionInterface> impl,
-    const std::vector<uint64_t> &indicies,
-    const Arguments &args)
+    IndexQueue &indicies,
+    const Arguments &args,
+    LatencyRecorder &latencies)
 {
 	std::filesystem::create_directory(args.outputDir / Data::TemplateDir,
 	    args.outputDir);
@@ -629,156 +1174,396 @@ ELFT::Validation::runExtractionCreate(
 		    args.outputDir / Data::TemplateDir);
 
 	const std::string logName{"extractionCreate-" +
-	    e2i2s(*args.templateType) + '-' + ts(getpid()) + ".log"};
+	    e2i2s(*args.templateType) + '-' + getWorkerIdentifier() + ".log"};
 	std::ofstream file{args.outputDir / logName};
 	if (!file)
-		throw std::runtime_error(ts(getpid()) + ": Error creating log "
-		    "file");
+		throw std::runtime_error(getWorkerIdentifier() +
+		    ": Error creating log file");
 
 	static const std::string header{"\"identifier\",elapsed,result,"
-	    "\"message\",type,num_images,size"};
+	    "\"message\",type,num_images,size," +
+	    std::string(ResourceUsageHeader) + ",\"impl_metrics\""};
 	file << header << '\n';
 	if (!file)
-		throw std::runtime_error(ts(getpid()) + ": Error writing to "
-		    "log");
+		throw std::runtime_error(getWorkerIdentifier() +
+		    ": Error writing to log");
+
+	/* Optionally append references to this process' archive segment */
+	std::optional<TemplateArchiveSegment> segment{};
+	if (args.streamArchive) {
+		const auto paths = getTemplateArchiveSegment(args,
+		    getWorkerIdentifier());
+		segment.emplace();
+		segment->archive.open(paths.archive, std::ios_base::out |
+		    std::ios_base::binary | std::ios_base::trunc);
+		segment->manifest.open(paths.manifest, std::ios_base::out |
+		    std::ios_base::binary | std::ios_base::trunc);
+		if (!segment->archive || !segment->manifest)
+			throw std::runtime_error(getWorkerIdentifier() +
+			    ": Error creating template archive segment");
+	}
 
-	for (const auto &n : indicies) {
-		file << performSingleCreate(impl, n, args) << '\n';
+	std::vector<uint64_t> taken{};
+	for (auto n = indicies.next(); n; n = indicies.next()) {
+		taken.push_back(*n);
+		const auto logLine = performSingleCreate(impl, *n, args,
+		    latencies, segment ? &(*segment) : nullptr);
+
+		const TraceSpan span{"write log", "io"};
+		file << logLine << '\n';
 		if (!file)
-			throw std::runtime_error(ts(getpid()) + ": Error "
-			    "writing to log");
+			throw std::runtime_error(getWorkerIdentifier() +
+			    ": Error writing to log");
 	}
+
+	if (segment) {
+		segment->archive.close();
+		segment->manifest.close();
+		if (!segment->archive || !segment->manifest)
+			throw std::runtime_error(getWorkerIdentifier() +
+			    ": Error writing template archive segment");
+	}
+
+	return (taken);
 }
 
 void
 ELFT::Validation::runExtractionExtractData(
     std::shared_ptr<ExtractionInterface> impl,
     const std::vector<uint64_t> &indicies,
-    const Arguments &args)
-
+    const Arguments &args,
+    LatencyRecorder &latencies)
 {
 	static const std::string header{"\"template_filename\",elapsed,"
-	    "type,index,num_templates_in_buffer,image_identifier,quality,"
-	    "imp,frct,frgp,orientation,lpm,value_assessment,lsb,pat,plr,trv,"
-	    "\"cores\",\"deltas\",\"minutia\",\"roi\",\"rqm\",complex"};
+	    "type,index,num_templates_in_buffer,"
+	    "image_identifier,quality,imp,frct,frgp,orientation,lpm,value_assessment,lsb,pat,plr,trv,"
+	    "\"cores\",\"deltas\",\"minutia\",\"roi\",\"rqm\",complex,"
+	    "\"impl_metrics\""};
 
 	const std::string logName{"extractionData-" +
-	    e2i2s(*args.templateType) + '-' + ts(getpid()) + ".log"};
-	std::ofstream file{args.outputDir / logName};
-	if (!file)
-		throw std::runtime_error(ts(getpid()) + ": Error creating log "
-		    "file");
+	    e2i2s(*args.templateType) + '-' + getWorkerIdentifier() + ".log"};
+	LogWriter log{args.outputDir / logName};
+	log << header << '\n';
 
-	file << header << '\n';
-	if (!file)
-		throw std::runtime_error(ts(getpid()) + ": Error writing to "
-		    "log");
+	/* Streamed references are read back from this process' segment */
+	std::optional<TemplateArchiveReader> segment{};
+	if (args.streamArchive)
+		segment.emplace(getTemplateArchiveSegment(args,
+		    getWorkerIdentifier()), 1);
 
 	for (const auto &n : indicies) {
 		std::string id{};
 		std::tie(id, std::ignore) = getImageSet(n, *args.templateType);
 
+		if (segment) {
+			const auto tmpl = segment->at(id);
+			if (!tmpl)
+				throw std::runtime_error(
+				    getWorkerIdentifier() + ": " + id + " is "
+				    "missing from template archive "
+				    "segment");
+			performSingleExtractData(impl, *args.templateType,
+			    id + Data::TemplateSuffix, std::vector<std::byte>(
+			    tmpl->data, tmpl->data + tmpl->size), latencies,
+			    log);
+			continue;
+		}
+
 		const std::filesystem::path f{
 		    args.outputDir / Data::getTemplateDir(*args.templateType) /
 		    std::string(id + Data::TemplateSuffix)};
-		file << performSingleExtractData(impl, *args.templateType, f) <<
-		    '\n';
+		performSingleExtractData(impl, *args.templateType, f,
+		    latencies, log);
 	}
+
+	log.close();
 }
+
+void
+ELFT::Validation::runLoadSizeSweep(
+    const Arguments &args)
+{
+	std::filesystem::create_directory(args.outputDir);
+
+	const auto sweepPath = args.outputDir / "loadSweep.log";
+	std::ofstream sweepLog{sweepPath};
+	if (!sweepLog)
+		throw std::runtime_error("Could not open " + sweepPath.string());
+
+	bool needHeader{true};
+	for (const auto &loadSize : args.loadSizeSweep) {
+		Arguments budgetArgs{args};
+		budgetArgs.loadSize = loadSize;
+		budgetArgs.loadSizeSweep.clear();
+		budgetArgs.outputDir = args.outputDir / ("load-" +
+		    ts(loadSize));
+
+		/* Probe templates are read from within the output directory */
+		std::filesystem::create_directory(budgetArgs.outputDir);
+		const auto templateLink = budgetArgs.outputDir /
+		    Data::TemplateDir;
+		if (!std::filesystem::exists(std::filesystem::symlink_status(
+		    templateLink)))
+			std::filesystem::create_directory_symlink(
+			    std::filesystem::absolute(args.outputDir /
+			    Data::TemplateDir), templateLink);
+
+		/* Fresh process, so peak memory is only from this budget */
+		const auto pid = fork();
+		switch (pid) {
+		case 0:		/* Child */
+			try {
+				testOperation(budgetArgs);
+			} catch (const std::exception &e) {
+				std::cerr << "Load size " << ts(loadSize) <<
+				    ": " << e.what() << '\n';
+				std::exit(EXIT_FAILURE);
+			} catch (...) {
+				std::cerr << "Load size " << ts(loadSize) <<
+				    ": Caught unknown exception\n";
+				std::exit(EXIT_FAILURE);
+			}
+			std::exit(EXIT_SUCCESS);
+
+			/* Not reached */
+			break;
+		case -1:	/* Error */
+			throw std::runtime_error("Error during fork()");
+		default:	/* Parent */
+			break;
+		}
+		waitForExit(1);
+
+		/* Collect the line logged by the child */
+		const auto loadPath = budgetArgs.outputDir / "load.log";
+		std::ifstream loadLog{loadPath};
+		std::string header{}, line{};
+		if (!std::getline(loadLog, header) ||
+		    !std::getline(loadLog, line))
+			throw std::runtime_error("Search with load size " +
+			    ts(loadSize) + " did not complete. See " +
+			    budgetArgs.outputDir.string());
+		if (needHeader) {
+			sweepLog << header << '\n';
+			needHeader = false;
+		}
+		sweepLog << line << '\n';
+		if (!sweepLog)
+			throw std::runtime_error("Error writing " +
+			    sweepPath.string());
+	}
+}
+
+void
+ELFT::Validation::runOperation(
+    const Implementation &impl,
+    IndexQueue &indicies,
+    const Arguments &args)
+{
+	LatencyRecorder latencies{};
+	if (args.perfCounters) {
+		const auto logPath = args.outputDir / ("perfCounters-" +
+		    getOperationName(args) + '-' + getWorkerIdentifier() +
+		    ".log");
+		workerCounterLog.open(logPath);
+		/* Counting scope is in every row; see -P in usage */
+		workerCounterLog << "\"operation\",\"identifier\"," <<
+		    PerformanceEventHeader << ",\"threads_counted\"\n";
+		if (!workerCounterLog)
+			throw std::runtime_error(getWorkerIdentifier() +
+			    ": Error creating " + logPath.string());
+		workerCounters = std::make_unique<PerformanceCounters>();
+	}
+
+	switch (args.operation.value()) {
+	case Operation::Extract:
+	{
+		const auto &extractionImpl = std::get<std::shared_ptr<
+		    ELFT::ExtractionInterface>>(impl);
+		const auto taken = runExtractionCreate(extractionImpl,
+		    indicies, args, latencies);
+		runExtractionExtractData(extractionImpl, taken, args,
+		    latencies);
+		break;
+	}
+	case Operation::Search:
+		runSearch(std::get<std::shared_ptr<ELFT::SearchInterface>>(
+		    impl), indicies, args, latencies);
+		break;
+	default:
+		throw std::runtime_error("Unsupported operation was sent to "
+		    "runOperation()");
+	}
+
+	workerCounters.reset();
+	if (workerCounterLog.is_open())
+		workerCounterLog.close();
+
+	writeTraceSpans(args.outputDir / ("trace-" + getOperationName(args) +
+	    '-' + getWorkerIdentifier() + ".part"), getWorkerIdentifier());
+
+	/* Merged with other workers' histograms once everyone is done */
+	latencies.write(args.outputDir / ("latency-" + getOperationName(args) +
+	    '-' + getWorkerIdentifier() + ".hist"));
+}
+
 void
 ELFT::Validation::runSearch(
     std::shared_ptr<SearchInterface> impl,
-    const std::vector<uint64_t> &indicies,
-    const Arguments &args)
+    IndexQueue &indicies,
+    const Arguments &args,
+    LatencyRecorder &latencies)
 {
 	/* Configure candidate list log */
-	const std::string candidateLogName{"searchCandidates-" + ts(getpid()) +
-	    ".log"};
-	std::ofstream candidateLog{args.outputDir / candidateLogName};
-	if (!candidateLog)
-		throw std::runtime_error(ts(getpid()) + ": Error creating "
-		    "candidate log file");
+	const std::string candidateLogName{"searchCandidates-" +
+	    getWorkerIdentifier() + ".log"};
+	LogWriter candidateLog{args.outputDir / candidateLogName};
 
 	static const std::string candidateLogHeader{"\"identifier\","
-	    "max_candidates,elapsed,result,\"message\",decision,num_candidates,"
-	    "rank,\"candidate_identifier\",candidate_frgp,"
-	    "candidate_similarity"};
+	    "max_candidates,elapsed,result,\"message\",decision,"
+	    "num_candidates,rank,\"candidate_identifier\",candidate_frgp,"
+	    "candidate_similarity," + std::string(ResourceUsageHeader) +
+	    ",\"impl_metrics\""};
 	candidateLog << candidateLogHeader << '\n';
-	if (!candidateLog)
-		throw std::runtime_error(ts(getpid()) + ": Error writing to "
-		    "candidate log");
 
 	/* Configure correspondence log */
-	const std::string corrLogName{"correspondence-" + ts(getpid()) +
-	    ".log"};
-	std::ofstream corrLog{args.outputDir / corrLogName};
-	if (!corrLog)
-		throw std::runtime_error(ts(getpid()) + ": Error creating "
-		    "correspondence log file");
+	const std::string corrLogName{"correspondence-" +
+	    getWorkerIdentifier() + ".log"};
+	LogWriter corrLog{args.outputDir / corrLogName};
 
 	static const std::string corrLogHeader{"\"probe_identifier\","
 	    "num_candidates,elapsed,rank,correspondence_index,complex,"
 	    "correspondence_type,\"corr_probe_id\",probe_input_id,"
 	    "probe_x,probe_y,probe_theta,probe_type,\"ref_id\","
-	    "ref_input_id,ref_x,ref_y,ref_theta,ref_type"};
+	    "ref_input_id,ref_x,ref_y,ref_theta,ref_type," +
+	    std::string(ResourceUsageHeader) + ",\"impl_metrics\""};
 	corrLog << corrLogHeader << '\n';
-	if (!corrLog)
-		throw std::runtime_error(ts(getpid()) + ": Error writing to "
-		    "correspondence log");
 
-	for (const auto &n : indicies) {
+	for (auto n = indicies.next(); n; n = indicies.next()) {
 		/* Load template */
 		std::string probeIdentifier{};
-		std::tie(probeIdentifier, std::ignore) = Data::Probes.at(n);
-		const auto probeTemplate = readFile(args.outputDir /
-		    Data::ProbeTemplateDir /
-		    (probeIdentifier + Data::TemplateSuffix));
+		std::tie(probeIdentifier, std::ignore) = Data::Probes.at(*n);
+		std::vector<std::byte> probeTemplate{};
+		{
+			const TraceSpan span{"read template", "io",
+			    probeIdentifier};
+			probeTemplate = readFile(args.outputDir /
+			    Data::ProbeTemplateDir /
+			    (probeIdentifier + Data::TemplateSuffix));
+		}
+
+		const auto searchResult = performSingleSearch(impl,
+		    probeIdentifier, probeTemplate,
+		    static_cast<uint16_t>(args.maximum), latencies,
+		    candidateLog);
+		performSingleSearchExtract(impl, probeIdentifier,
+		    probeTemplate, searchResult, latencies, corrLog);
+	}
+
+	candidateLog.close();
+	corrLog.close();
+}
+
+void
+ELFT::Validation::runThreads(
+    const Implementation &impl,
+    IndexQueue &indicies,
+    const Arguments &args)
+{
+	if (args.numThreads <= 1) {
+		runOperation(impl, indicies, args);
+		return;
+	}
 
-		const auto &[searchResult, candidateLogLine] =
-		    performSingleSearch(impl, probeIdentifier, probeTemplate,
-		    static_cast<uint16_t>(args.maximum));
-		candidateLog << candidateLogLine << '\n';
+	std::exception_ptr error{};
+	std::mutex errorMutex{};
+	std::vector<std::thread> threads{};
+	threads.reserve(args.numThreads);
+	for (uint16_t i{0}; i < args.numThreads; ++i) {
+		threads.emplace_back([&, i]() {
+			workerThread = i;
+			try {
+				runOperation(impl, indicies, args);
+			} catch (...) {
+				const std::lock_guard<std::mutex> lock{
+				    errorMutex};
+				if (!error)
+					error = std::current_exception();
+			}
+		});
+	}
+	for (auto &thread : threads)
+		thread.join();
 
-		corrLog << performSingleSearchExtract(impl, probeIdentifier,
-		    probeTemplate, searchResult) << '\n';
+	if (error)
+		std::rethrow_exception(error);
+}
 
-		if (!candidateLog)
-			throw std::runtime_error(ts(getpid()) + ": "
-			    "Error writing to candidate log");
+void
+ELFT::Validation::performSingleExtractData(
+    const std::shared_ptr<ExtractionInterface> impl,
+    TemplateType templateType,
+    const std::filesystem::path &p,
+    LatencyRecorder &latencies,
+    LogWriter &log)
+{
+	std::vector<std::byte> tmpl{};
+	{
+		const TraceSpan span{"read template", "io",
+		    p.filename().string()};
+		tmpl = readFile(p);
 	}
+
+	performSingleExtractData(impl, templateType, p.filename().string(),
+	    std::move(tmpl), latencies, log);
 }
 
-std::string
+void
 ELFT::Validation::performSingleExtractData(
     const std::shared_ptr<ExtractionInterface> impl,
     TemplateType templateType,
-    const std::filesystem::path &p)
+    const std::string &name,
+    std::vector<std::byte> &&tmpl,
+    LatencyRecorder &latencies,
+    LogWriter &log)
 {
-	const CreateTemplateResult ctr{{}, readFile(p)};
+	const CreateTemplateResult ctr{{}, std::move(tmpl)};
 	std::optional<std::tuple<ReturnStatus, std::vector<TemplateData>>>
 	    ret{};
 
 	std::chrono::steady_clock::time_point start{}, stop{};
+	std::string metrics{};
 	try {
+		const std::string operation{"extractTemplateData type=" +
+		    e2i2s(templateType)};
+
 		start = std::chrono::steady_clock::now();
 		ret = impl->extractTemplateData(templateType, ctr);
 		stop = std::chrono::steady_clock::now();
+		recordTraceSpan("extractTemplateData", "api", start, stop,
+		    name);
+		latencies.record(operation, stop - start,
+		    std::chrono::milliseconds{500});
+		metrics = recordCallMetrics(impl->getLastCallMetrics(),
+		    operation, latencies);
 	} catch (const std::exception &e) {
 		throw std::runtime_error("Exception while extracting data from "
-		    "template " + p.string() + " (" + e.what() + ")");
+		    "template " + name + " (" + e.what() + ")");
 	} catch (...) {
 		throw std::runtime_error("Unknown exception while extracting "
-		    "data from template " + p.string());
+		    "data from template " + name);
 	}
 
-	const std::string logLinePrefix{'"' + p.filename().string() + "\"," +
+	const std::string logLinePrefix{'"' + name + "\"," +
 	    duration(start, stop) + ',' + e2i2s(templateType) + ','};
+	const std::string logLineSuffix{',' + metrics + '\n'};
 
 	if (!ret.has_value() || !std::get<ReturnStatus>(*ret)) {
 		static const uint8_t numElements{20};
 		static const std::string NAFull = splice(
 		    std::vector<std::string>(numElements, NA), ",");
-		return (logLinePrefix + NAFull);
+		log << logLinePrefix << NAFull << logLineSuffix;
+		return;
 	}
 
 	const auto &data = std::get<std::vector<TemplateData>>(ret.value());
@@ -787,18 +1572,24 @@ ELFT::Validation::performSingleExtractData(
 	for (std::vector<TemplateData>::size_type i{}; i < data.size(); ++i) {
 		const auto &td = data.at(i);
 
-		logLine += logLinePrefix + ts(i) + ',' + ts(data.size()) +
-		    ',' + ts(td.inputIdentifier) + ',';
-		logLine += (td.imageQuality ? ts(*td.imageQuality) : NA) + ',';
+		log << logLinePrefix << i << ',' << data.size() << ',' <<
+		    td.inputIdentifier << ',';
+		if (td.imageQuality)
+			log << *td.imageQuality << ',';
+		else
+			log << NA << ',';
 
 		static const uint8_t efsElements{16};
 		static const std::string NAEFS = splice(
 		    std::vector<std::string>(efsElements, NA), ",");
 		if (!td.efs) {
-			logLine += NAEFS + '\n';
+			log << NAEFS << logLineSuffix;
 			continue;
 		}
 
+		/* Optional and nested fields reuse one buffer for all rows */
+		logLine.clear();
+
 		const auto &efs = td.efs.value();
 		logLine += e2i2s(efs.imp) + ',' + e2i2s(efs.frct) + ',' +
 		    e2i2s(efs.frgp) + ',';
@@ -821,24 +1612,24 @@ ELFT::Validation::performSingleExtractData(
 		logLine += (efs.rqm ? '"' + splice(*efs.rqm)  + '"': NA) + ',';
 		logLine += (efs.complex ? ts(*efs.complex) : NA);
 
-		logLine += '\n';
+		log << logLine << logLineSuffix;
 	}
-
-	/* Remove last newline */
-	logLine.pop_back();
-	return (logLine);
 }
 
 std::string
 ELFT::Validation::performSingleCreate(
     const std::shared_ptr<ExtractionInterface> impl,
     const uint64_t imageIndex,
-    const Arguments &args)
+    const Arguments &args,
+    LatencyRecorder &latencies,
+    TemplateArchiveSegment *segment)
 {
 	const auto &[identifier, mds] = getImageSet(imageIndex,
 	    *args.templateType);
 	std::vector<std::tuple<std::optional<Image>, std::optional<EFS>>>
 	    samples{};
+	std::optional<TraceSpan> readSpan{};
+	readSpan.emplace("read images", "io", identifier);
 	for (decltype(mds)::size_type i{}; i < mds.size(); ++i) {
 		const auto &md = mds.at(i);
 
@@ -876,14 +1667,32 @@ ELFT::Validation::performSingleCreate(
 		} else
 			samples.emplace_back(std::nullopt, md.efs);
 	}
+	readSpan.reset();
 
 	CreateTemplateResult rv{};
 	std::chrono::steady_clock::time_point start{}, stop{};
+	ResourceUsage before{}, after{};
+	std::string metrics{};
 	try {
+		const std::string operation{"createTemplate type=" +
+		    e2i2s(*args.templateType) + " samples=" +
+		    ts(samples.size())};
+
+		before = ResourceUsage::sample(true);
+		startPerformanceCounters();
 		start = std::chrono::steady_clock::now();
 		rv = impl->createTemplate(*args.templateType, identifier,
 		    samples);
 		stop = std::chrono::steady_clock::now();
+		recordTraceSpan("createTemplate", "api", start, stop,
+		    identifier);
+		stopPerformanceCounters(operation, identifier, latencies);
+		after = ResourceUsage::sample(false);
+		latencies.record(operation, stop - start,
+		    getCreateTemplateTimeLimit(getImageSet(imageIndex,
+		    *args.templateType), *args.templateType));
+		metrics = recordCallMetrics(impl->getLastCallMetrics(),
+		    operation, latencies);
 	} catch (const std::exception &e) {
 		throw std::runtime_error("Exception while creating template "
 		    "from " + identifier + " (" + e.what() + ")");
@@ -893,11 +1702,34 @@ ELFT::Validation::performSingleCreate(
 	}
 
 	std::string logLine{'"' + identifier + "\"," + duration(start, stop) +
-	    ',' + e2i2s(rv.status.result) + ',' + sanitizeMessage(
+	    ',' +
+	    e2i2s(rv.status.result) + ',' + sanitizeMessage(
 	    rv.status.message ? *rv.status.message : "") + ',' +
 	    e2i2s(*args.templateType) + ',' + ts(samples.size()) + ','};
 
 	/* Write template */
+	const TraceSpan writeSpan{"write template", "io", identifier};
+	if (rv.status.result != ReturnStatus::Result::Success)
+		rv.data.clear();
+	if (segment != nullptr) {
+		segment->archive.write(reinterpret_cast<const char*>(
+		    rv.data.data()), static_cast<std::streamsize>(
+		    rv.data.size()));
+		segment->manifest << identifier << ' ' << rv.data.size() <<
+		    ' ' << segment->size << '\n';
+		if (!segment->archive || !segment->manifest)
+			throw std::runtime_error("Could not write template "
+			    "from " + identifier + " to archive segment");
+		segment->size += rv.data.size();
+
+		if (rv.status.result == ReturnStatus::Result::Success)
+			logLine += ts(rv.data.size());
+		else
+			logLine += NA;
+		return (logLine + ',' + formatResourceUsage(before, after) +
+		    ',' + metrics);
+	}
+
 	const auto dir = args.outputDir /
 	    Data::getTemplateDir(*args.templateType);
 	if (rv.status.result == ReturnStatus::Result::Success) {
@@ -908,15 +1740,18 @@ ELFT::Validation::performSingleCreate(
 		logLine += NA;
 	}
 
-	return (logLine);
+	return (logLine + ',' + formatResourceUsage(before, after) + ',' +
+	    metrics);
 }
 
-std::tuple<ELFT::SearchResult, std::string>
+ELFT::SearchResult
 ELFT::Validation::performSingleSearch(
     const std::shared_ptr<SearchInterface> impl,
     const std::string &identifier,
     const std::vector<std::byte> &probeTemplate,
-    const uint16_t maxCandidates)
+    const uint16_t maxCandidates,
+    LatencyRecorder &latencies,
+    LogWriter &log)
 {
 	/*
 	 * NOTE: We don't search 0-byte templates, even if that's what was
@@ -933,10 +1768,23 @@ ELFT::Validation::performSingleSearch(
 
 	SearchResult rv{};
 	std::chrono::steady_clock::time_point start{}, stop{};
+	ResourceUsage before{}, after{};
+	std::string metrics{};
 	try {
+		const std::string operation{"search max_candidates=" +
+		    ts(maxCandidates)};
+
+		before = ResourceUsage::sample(true);
+		startPerformanceCounters();
 		start = std::chrono::steady_clock::now();
 		rv = impl->search(probeTemplate, maxCandidates);
 		stop = std::chrono::steady_clock::now();
+		recordTraceSpan("search", "api", start, stop, identifier);
+		stopPerformanceCounters(operation, identifier, latencies);
+		after = ResourceUsage::sample(false);
+		latencies.record(operation, stop - start);
+		metrics = recordCallMetrics(impl->getLastCallMetrics(),
+		    operation, latencies);
 	} catch (const std::exception &e) {
 		throw std::runtime_error("Exception while searching template "
 		    "for " + identifier + " (" + e.what() + ")");
@@ -949,41 +1797,50 @@ ELFT::Validation::performSingleSearch(
 	    ts(maxCandidates) + ',' + duration(start, stop) + ',' +
 	    e2i2s(rv.status.result) + ',' +
 	    sanitizeMessage(rv.status.message ? *rv.status.message : "") + ','};
-	std::string logLine{};
+	const std::string logLineSuffix{',' +
+	    formatResourceUsage(before, after) + ',' + metrics + '\n'};
+	static const std::string NACandidate = splice(
+	    std::vector<std::string>(6, NA), ",");
 	if (rv.status) {
 		if (rv.candidateList.size() > 0) {
-			/* API says driver will stable sort by similarity */
-			std::stable_sort(rv.candidateList.begin(),
-			    rv.candidateList.end(), std::greater<Candidate>());
+			/*
+			 * API says driver will stable sort by similarity.
+			 * Lists already in that order would be unchanged.
+			 */
+			if (!std::is_sorted(rv.candidateList.cbegin(),
+			    rv.candidateList.cend(), std::greater<Candidate>()))
+				std::stable_sort(rv.candidateList.begin(),
+				    rv.candidateList.end(),
+				    std::greater<Candidate>());
 
 			std::vector<Candidate>::size_type rank{};
 			for (const auto &c : rv.candidateList) {
-				logLine += logLinePrefix + ts(rv.decision) +
-				    ',' + ts(rv.candidateList.size()) + ',' +
-				    ts(++rank) + ",\"" + c.identifier + "\"," +
-				    e2i2s(c.frgp) + ',' + ts(c.similarity);
-				if (rank < rv.candidateList.size())
-					logLine += '\n';
+				log << logLinePrefix << rv.decision << ',' <<
+				    rv.candidateList.size() << ',' << ++rank <<
+				    ",\"" << c.identifier << "\"," <<
+				    e2i(c.frgp) << ',' << c.similarity <<
+				    logLineSuffix;
 			}
 		} else {
 			/* Success, but no candidates (converted to failure) */
-			logLine += logLinePrefix + splice(
-			    std::vector<std::string>(6, NA), ",");
+			log << logLinePrefix << NACandidate <<
+			    logLineSuffix;
 		}
 	} else {
-		logLine += logLinePrefix + splice(
-		    std::vector<std::string>(6, NA), ",");
+		log << logLinePrefix << NACandidate << logLineSuffix;
 	}
 
-	return {rv, logLine};
+	return (rv);
 }
 
-std::string
+void
 ELFT::Validation::performSingleSearchExtract(
     const std::shared_ptr<SearchInterface> impl,
     const std::string &identifier,
     const std::vector<std::byte> &probeTemplate,
-    const SearchResult &searchResult)
+    const SearchResult &searchResult,
+    LatencyRecorder &latencies,
+    LogWriter &log)
 {
 	/*
 	 * NOTE: We don't search 0-byte templates, even if that's what was
@@ -1000,11 +1857,23 @@ ELFT::Validation::performSingleSearchExtract(
 
 	std::optional<CorrespondenceResult> ret{};
 	std::chrono::steady_clock::time_point start{}, stop{};
+	ResourceUsage before{}, after{};
+	std::string metrics{};
 	try {
+		before = ResourceUsage::sample(true);
+		startPerformanceCounters();
 		start = std::chrono::steady_clock::now();
 		ret = impl->extractCorrespondence(probeTemplate,
 		    searchResult);
 		stop = std::chrono::steady_clock::now();
+		recordTraceSpan("extractCorrespondence", "api", start, stop,
+		    identifier);
+		stopPerformanceCounters("extractCorrespondence", identifier,
+		    latencies);
+		after = ResourceUsage::sample(false);
+		latencies.record("extractCorrespondence", stop - start);
+		metrics = recordCallMetrics(impl->getLastCallMetrics(),
+		    "extractCorrespondence", latencies);
 	} catch (const std::exception &e) {
 		throw std::runtime_error("Exception while extracting "
 		    "correspondence for " + identifier + " (" + e.what() + ")");
@@ -1016,12 +1885,15 @@ ELFT::Validation::performSingleSearchExtract(
 	const std::string logLinePrefix{'"' + identifier + "\"," +
 	    ts(searchResult.candidateList.size()) + ',' +
 	    duration(start, stop) + ','};
+	const std::string logLineSuffix{',' +
+	    formatResourceUsage(before, after) + ',' + metrics + '\n'};
 
 	if (!ret.has_value() || !ret->status) {
 		static const uint8_t numElements{16};
 		static const std::string NAFull = splice(
 		    std::vector<std::string>(numElements, NA), ",");
-		return (logLinePrefix + NAFull);
+		log << logLinePrefix << NAFull << logLineSuffix;
+		return;
 	}
 
 	const auto &corrs = ret->data.correspondence;
@@ -1030,42 +1902,34 @@ ELFT::Validation::performSingleSearchExtract(
 		    "of Correspondences must be the same as the number of "
 		    "Candidates."};
 
-	std::string logLine{};
+	const std::string complex{ret->data.complex ?
+	    ts(*ret->data.complex) : NA};
 	std::vector<std::vector<Correspondence>>::size_type rank{};
 	for (const auto &candidate : corrs) {
 		++rank;
 		std::vector<Correspondence>::size_type corrIndex{};
 		for (const auto &corr : candidate) {
-			logLine += logLinePrefix +
-			    ts(rank) + ',' + ts(++corrIndex) + ',' +
-			    (ret->data.complex ? ts(*ret->data.complex) : NA) +
-			    ',' + e2i2s(corr.type) + ',' +
-			    '"' + corr.probeIdentifier + "\"," +
-			    ts(corr.probeInputIdentifier) + ',' +
-			    ts(corr.probeMinutia.coordinate.x) + ',' +
-			    ts(corr.probeMinutia.coordinate.y) + ',' +
-			    ts(corr.probeMinutia.theta) + ',' +
-			    e2i2s(corr.probeMinutia.type) + ',' +
-			    '"' + corr.referenceIdentifier + "\"," +
-			    ts(corr.referenceInputIdentifier) + ',';
+			log << logLinePrefix << rank << ',' << ++corrIndex <<
+			    ',' << complex << ',' << e2i(corr.type) << ",\"" <<
+			    corr.probeIdentifier << "\"," <<
+			    corr.probeInputIdentifier << ',' <<
+			    corr.probeMinutia.coordinate.x << ',' <<
+			    corr.probeMinutia.coordinate.y << ',' <<
+			    corr.probeMinutia.theta << ',' <<
+			    e2i(corr.probeMinutia.type) << ",\"" <<
+			    corr.referenceIdentifier << "\"," <<
+			    corr.referenceInputIdentifier << ',';
 			if ((corr.type == CorrespondenceType::Definite) ||
 			    (corr.type == CorrespondenceType::Possible))
-				logLine +=
-				    ts(corr.referenceMinutia.coordinate.x) +
-				    ',' +
-				    ts(corr.referenceMinutia.coordinate.y) +
-				    ',' +
-				    ts(corr.referenceMinutia.theta) + ',' +
-				    e2i2s(corr.referenceMinutia.type) + '\n';
+				log << corr.referenceMinutia.coordinate.x <<
+				    ',' << corr.referenceMinutia.coordinate.y <<
+				    ',' << corr.referenceMinutia.theta << ',' <<
+				    e2i(corr.referenceMinutia.type) <<
+				    logLineSuffix;
 			else
-				logLine += "NA,NA,NA,NA\n";
+				log << "NA,NA,NA,NA" << logLineSuffix;
 		}
 	}
-
-	/* Remove last newline */
-	logLine.pop_back();
-
-	return (logLine);
 }
 
 std::string
@@ -1102,34 +1966,117 @@ ELFT::Validation::sanitizeMessage(
 	return (wrapInQuotes ? '"' + sanitized + '"' : sanitized);
 }
 
-std::vector<std::vector<uint64_t>>
-ELFT::Validation::splitSet(
-    const std::vector<uint64_t> &combinedSet,
-    const uint8_t numSets)
+void
+ELFT::Validation::startPerformanceCounters()
 {
-	if (numSets == 0)
-		return {};
-	if (numSets == 1)
-		return {combinedSet};
-
-	const std::vector<uint64_t>::size_type size{static_cast<
-	    std::vector<uint64_t>::size_type>(
-	    std::ceil(static_cast<float>(combinedSet.size()) /
-	    static_cast<float>(numSets)))};
-	if (size < numSets)
-		throw std::invalid_argument("Too many sets.");
-
-	std::vector<std::vector<uint64_t>> sets{};
-	sets.reserve(numSets);
-	for (uint8_t i{0}; i < numSets; ++i)
-		sets.emplace_back(std::next(combinedSet.begin(),
-		    static_cast<std::vector<uint64_t>::difference_type>(
-		    size * i)),
-		    std::next(combinedSet.begin(),
-		    static_cast<std::vector<uint64_t>::difference_type>(
-		    std::min(size * (i + 1u), combinedSet.size()))));
-
-	return (sets);
+	if (workerCounters)
+		workerCounters->start();
+}
+
+void
+ELFT::Validation::stopPerformanceCounters(
+    const std::string &operation,
+    const std::string &identifier,
+    LatencyRecorder &latencies)
+{
+	if (!workerCounters)
+		return;
+
+	const auto counts = workerCounters->stop();
+	latencies.recordEvents(operation, counts);
+	workerCounterLog << '"' << operation << "\",\"" << identifier <<
+	    "\"," << formatPerformanceEvents(counts) <<
+	    ",\"caller and its exited children\"\n";
+	if (!workerCounterLog)
+		throw std::runtime_error(getWorkerIdentifier() +
+		    ": Error writing to event counter log");
+}
+
+ELFT::Validation::LatencyRecorder
+ELFT::Validation::summarizeLatencies(
+    const Arguments &args,
+    const std::chrono::steady_clock::duration wallTime,
+    LatencyRecorder latencies)
+{
+	const auto name = getOperationName(args);
+	const std::string workerPrefix{"latency-" + name + '-'};
+
+	std::vector<std::filesystem::path> workerFiles{};
+	for (const auto &entry : std::filesystem::directory_iterator(
+	    args.outputDir)) {
+		const auto filename = entry.path().filename().string();
+		if ((entry.path().extension() != ".hist") ||
+		    (filename.compare(0, workerPrefix.length(),
+		    workerPrefix) != 0))
+			continue;
+		latencies.merge(LatencyRecorder::read(entry.path()));
+		workerFiles.push_back(entry.path());
+	}
+
+	const auto latencyPath = args.outputDir / ("latency-" + name + ".log");
+	std::ofstream latencyLog{latencyPath};
+	latencyLog << latencies.summarize(wallTime);
+	if (!latencyLog)
+		throw std::runtime_error("Error writing " +
+		    latencyPath.string());
+
+	const auto limitPath = args.outputDir / ("timeLimits-" + name +
+	    ".log");
+	std::ofstream limitLog{limitPath};
+	limitLog << latencies.summarizeTimeLimits();
+	if (!limitLog)
+		throw std::runtime_error("Error writing " +
+		    limitPath.string());
+
+	if (args.perfCounters) {
+		const auto eventPath = args.outputDir / ("perfCounters-" +
+		    name + ".log");
+		std::ofstream eventLog{eventPath};
+		eventLog << latencies.summarizeEvents();
+		if (!eventLog)
+			throw std::runtime_error("Error writing " +
+			    eventPath.string());
+	}
+
+	for (const auto &path : workerFiles)
+		std::filesystem::remove(path);
+
+	const auto violations = latencies.getTimeLimitViolations();
+	if (violations > 0)
+		std::cerr << "[WARNING] " << ts(violations) << " call(s) took "
+		    "longer than the time limit in elft.h. See " <<
+		    limitPath.string() << '\n';
+
+	return (latencies);
+}
+
+void
+ELFT::Validation::summarizeTrace(
+    const Arguments &args)
+{
+	if (!args.trace)
+		return;
+
+	/* Spans from the calling thread, outside of any worker */
+	const auto name = getOperationName(args);
+	const std::string partPrefix{"trace-" + name + '-'};
+	writeTraceSpans(args.outputDir / (partPrefix + "driver.part"),
+	    "driver");
+
+	std::vector<std::filesystem::path> parts{};
+	for (const auto &entry : std::filesystem::directory_iterator(
+	    args.outputDir)) {
+		const auto filename = entry.path().filename().string();
+		if ((entry.path().extension() == ".part") &&
+		    (filename.compare(0, partPrefix.length(),
+		    partPrefix) == 0))
+			parts.push_back(entry.path());
+	}
+	std::sort(parts.begin(), parts.end());
+
+	mergeTraceFiles(parts, args.outputDir / ("trace-" + name + ".json"));
+	for (const auto &path : parts)
+		std::filesystem::remove(path);
 }
 
 void
@@ -1166,24 +2113,71 @@ ELFT::Validation::testOperation(
 		throw std::runtime_error("Unsupported operation was send to "
 		    "testOperation()");
 	}
-	const auto indicies = randomizeIndicies(containerSize, args.randomSeed);
+	auto indicies = randomizeIndicies(containerSize, args.randomSeed);
+
+	/*
+	 * Longest processing time first: start the expensive ImageSets
+	 * while there is still other work to fill in behind them.
+	 */
+	if (args.longestFirst) {
+		std::vector<std::chrono::milliseconds> limits(containerSize);
+		for (const auto &i : indicies)
+			limits[i] = getCreateTemplateTimeLimit(
+			    getImageSet(i, *args.templateType),
+			    *args.templateType);
+		std::stable_sort(indicies.begin(), indicies.end(),
+		    [&limits](const uint64_t lhs, const uint64_t rhs) {
+			return (limits[lhs] > limits[rhs]);
+		});
+	}
+
+	if (args.trace)
+		enableTracing();
+
+	if (args.perfCounters)
+		for (const auto &event : PerformanceCounters().getUnavailable())
+			std::cerr << "[WARNING] Cannot count " << event <<
+			    '\n';
 
 	/* Instantiate only the appropriate interface */
-	std::variant<std::shared_ptr<ELFT::ExtractionInterface>,
-	    std::shared_ptr<ELFT::SearchInterface>> impl{};
+	Implementation impl{};
+	LatencyRecorder latencies{};
+	std::chrono::steady_clock::time_point start{}, stop{};
+	std::chrono::steady_clock::duration getImplementationTime{},
+	    loadTime{};
+	uint64_t loadPeakRSS{};
 	switch (args.operation.value()) {
 	case Operation::Extract:
+		start = std::chrono::steady_clock::now();
 		impl = ELFT::ExtractionInterface::getImplementation(
 		    args.configDir);
+		stop = std::chrono::steady_clock::now();
+		recordTraceSpan("getImplementation", "api", start, stop);
+		latencies.record("getImplementation", stop - start,
+		    std::chrono::seconds{5});
 		break;
 	case Operation::Search:
 	{
+		start = std::chrono::steady_clock::now();
 		impl = ELFT::SearchInterface::getImplementation(
 		    args.configDir, args.dbDir);
+		stop = std::chrono::steady_clock::now();
+		recordTraceSpan("getImplementation", "api", start, stop);
+		latencies.record("getImplementation", stop - start,
+		    std::chrono::seconds{5});
+		getImplementationTime = stop - start;
 
-		/* 10 MB: don't load the entire database to RAM. */
+		/* Default of 10 MB: don't load the entire database to RAM. */
+		start = std::chrono::steady_clock::now();
 		const auto status = std::get<std::shared_ptr<
-		    ELFT::SearchInterface>>(impl)->load(10000000);
+		    ELFT::SearchInterface>>(impl)->load(args.loadSize);
+		stop = std::chrono::steady_clock::now();
+		recordTraceSpan("load", "api", start, stop, "max_size=" +
+		    ts(args.loadSize));
+		latencies.record("load max_size=" + ts(args.loadSize),
+		    stop - start);
+		loadTime = stop - start;
+		loadPeakRSS = getPeakResidentSetSize();
 		if (!status) {
 			std::string err{"Error on SearchInterface::load()"};
 			if (status.message)
@@ -1198,55 +2192,35 @@ ELFT::Validation::testOperation(
 		break;
 	}
 
+	start = std::chrono::steady_clock::now();
 	if (args.numProcs <= 1) {
-		switch (args.operation.value()) {
-		case Operation::Extract:
-			runExtractionCreate(std::get<std::shared_ptr<
-			    ELFT::ExtractionInterface>>(impl), indicies, args);
- 			runExtractionExtractData(std::get<std::shared_ptr<
- 			    ELFT::ExtractionInterface>>(impl), indicies, args);
-			break;
-		case Operation::Search:
- 			runSearch(std::get<std::shared_ptr<
- 			    ELFT::SearchInterface>>(impl), indicies, args);
-			break;
-		default:
-			throw std::runtime_error("Unsupported operation was "
-			    "sent to testOperation()");
-			break;
-		}
+		std::atomic<uint64_t> position{0};
+		IndexQueue queue{indicies, position};
+		runThreads(impl, queue, args);
 	} else {
-		/* Split into multiple sets of indicies */
-		const auto sets = splitSet(indicies, args.numProcs);
+		/*
+		 * Children take indicies one at a time from a counter shared
+		 * across fork(), so that a child drawing expensive ImageSets
+		 * doesn't hold everyone else up.
+		 */
+		static_assert(std::atomic<uint64_t>::is_always_lock_free,
+		    "Shared counter must be usable across processes");
+		void *shared = ::mmap(nullptr, sizeof(std::atomic<uint64_t>),
+		    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (shared == MAP_FAILED)
+			throw std::runtime_error("Could not map shared memory");
+		auto *position = new (shared) std::atomic<uint64_t>{0};
 
 		/* Fork */
-		for (const auto &set : sets) {
+		std::optional<TraceSpan> forkSpan{};
+		forkSpan.emplace("fork", "process");
+		for (uint8_t i{0}; i < args.numProcs; ++i) {
 			const auto pid = fork();
 			switch (pid) {
 			case 0:		/* Child */
 				try {
-					switch (args.operation.value()) {
-					case Operation::Extract:
-						runExtractionCreate(std::get<
-						    std::shared_ptr<
-						    ELFT::ExtractionInterface>>(
-						    impl), set, args);
-		 				runExtractionExtractData(std::
-		 				    get<std::shared_ptr<
-		 				    ELFT::ExtractionInterface>>(
-		 				    impl), set, args);
-						break;
-					case Operation::Search:
- 						runSearch(std::get<
- 						    std::shared_ptr<
- 						    ELFT::SearchInterface>>(
- 						    impl), set, args);
-						break;
-					default:
-						throw std::runtime_error(
-						    "Invalid operation sent to "
-						    "testOperation()");
-					}
+					IndexQueue queue{indicies, *position};
+					runThreads(impl, queue, args);
 				} catch (const std::exception &e) {
 					std::cerr << e.what() << '\n';
 					std::exit(EXIT_FAILURE);
@@ -1266,12 +2240,62 @@ ELFT::Validation::testOperation(
 			}
 		}
 
-		waitForExit(args.numProcs);
+		forkSpan.reset();
+
+		{
+			const TraceSpan span{"wait", "process"};
+			waitForExit(args.numProcs);
+		}
+		::munmap(shared, sizeof(std::atomic<uint64_t>));
+	}
+	latencies = summarizeLatencies(args, std::chrono::steady_clock::now() -
+	    start, latencies);
+
+	if (args.operation.value() == Operation::Search) {
+		const auto peakRSS = std::max(getPeakResidentSetSize(),
+		    getPeakResidentSetSize(true));
+		const auto search = latencies.getHistogram("search "
+		    "max_candidates=" + ts(args.maximum));
+		const auto correspondence = latencies.getHistogram(
+		    "extractCorrespondence");
+		const auto us = [](const std::chrono::steady_clock::duration
+		    &d) {
+			return (std::chrono::duration_cast<
+			    std::chrono::microseconds>(d).count());
+		};
+
+		/* Times in microseconds, memory in KiB */
+		const auto logPath = args.outputDir / "load.log";
+		std::ofstream loadLog{logPath};
+		loadLog << "max_size,get_implementation,load,load_peak_rss,"
+		    "peak_rss,search_count,search_mean,search_p50,search_p99,"
+		    "correspondence_mean\n";
+		loadLog << ts(args.loadSize) << ',' <<
+		    us(getImplementationTime) << ',' << us(loadTime) << ',' <<
+		    loadPeakRSS << ',' << peakRSS << ',' << search.getCount() <<
+		    ',' << std::fixed << std::setprecision(3) <<
+		    search.getMean() << ',' << search.getPercentile(50) <<
+		    ',' << search.getPercentile(99) << ',' <<
+		    correspondence.getMean() << '\n';
+		if (!loadLog)
+			throw std::runtime_error("Error writing " +
+			    logPath.string());
 	}
 
 	if ((args.operation.value() == Operation::Extract) &&
-	    (args.templateType.value() == TemplateType::Reference))
-		makeReferenceTemplateArchive(args);
+	    (args.templateType.value() == TemplateType::Reference)) {
+		if (args.streamArchive) {
+			const TraceSpan span{"mergeTemplateArchiveSegments",
+			    "driver"};
+			mergeTemplateArchiveSegments(args);
+		} else {
+			const TraceSpan span{"makeReferenceTemplateArchive",
+			    "driver"};
+			makeReferenceTemplateArchive(args);
+		}
+	}
+
+	summarizeTrace(args);
 }
 
 void
@@ -1333,11 +2357,11 @@ main(
     char *argv[])
 {
 	if (!((ELFT::API_MAJOR_VERSION == 1) &&
-	    (ELFT::API_MINOR_VERSION == 2) &&
+	    (ELFT::API_MINOR_VERSION == 3) &&
 	    /* While not required, we want to make sure you're up to date. */
-	    (ELFT::API_PATCH_VERSION == 1))) {
+	    (ELFT::API_PATCH_VERSION == 0))) {
 		std::cerr << "Incompatible API version encountered.\n "
-		    "- Validation: 1.2.1\n - Participant: " <<
+		    "- Validation: 1.3.0\n - Participant: " <<
 		    ELFT::API_MAJOR_VERSION << '.' <<
 		    ELFT::API_MINOR_VERSION << '.' <<
 		    ELFT::API_PATCH_VERSION << '\n';
@@ -11,15 +11,23 @@
 #ifndef ELFT_VALIDATION_H_
 #define ELFT_VALIDATION_H_
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
 #include <random>
 #include <optional>
 #include <string>
+#include <variant>
 #include <vector>
 
 #include <elft.h>
 #include <elft_validation_data.h>
+#include <elft_validation_log.h>
+#include <elft_validation_stats.h>
 
 namespace ELFT::Validation
 {
@@ -49,6 +57,8 @@ namespace ELFT::Validation
 		std::optional<Operation> operation{};
 		/** Number of processes to run. */
 		uint8_t numProcs{1};
+		/** Number of threads to run in each process. */
+		uint16_t numThreads{1};
 		/** Configuration directory. */
 		std::filesystem::path configDir{};
 		/** Enrollment database directory. */
@@ -61,8 +71,131 @@ namespace ELFT::Validation
 		std::filesystem::path outputDir{"output"};
 		/** Directory containing images from ELFT::Validation::Data. */
 		std::filesystem::path imageDir{"images"};
+		/** Write references to TemplateArchive segments, not files. */
+		bool streamArchive{false};
+		/** Hand out the most expensive extractions first. */
+		bool longestFirst{false};
+		/** Memory budget passed to SearchInterface::load(). */
+		uint64_t loadSize{10000000};
+		/** Memory budgets to search with, one after another. */
+		std::vector<uint64_t> loadSizeSweep{};
+		/** Count hardware events during each call. */
+		bool perfCounters{false};
+		/** Write a timeline of driver and API activity. */
+		bool trace{false};
+	};
+
+	/** Either ELFT interface, whichever the operation requires. */
+	using Implementation = std::variant<std::shared_ptr<ExtractionInterface>,
+	    std::shared_ptr<SearchInterface>>;
+
+	/**
+	 * @brief
+	 * Indicies shared between workers.
+	 *
+	 * @details
+	 * Each index is handed to exactly one caller of next(), in order.
+	 * Workers that finish early simply take more work.
+	 */
+	class IndexQueue
+	{
+	public:
+		/**
+		 * @brief
+		 * IndexQueue constructor.
+		 *
+		 * @param indicies
+		 * Indicies to hand out. Must outlive this object.
+		 * @param position
+		 * Position of the next index to hand out, shared by every
+		 * IndexQueue over `indicies`. Must outlive this object.
+		 */
+		IndexQueue(
+		    const std::vector<uint64_t> &indicies,
+		    std::atomic<uint64_t> &position);
+
+		/**
+		 * @return
+		 * The next index, or no value if all have been handed out.
+		 */
+		std::optional<uint64_t>
+		next();
+
+	private:
+		/** Indicies to hand out. */
+		const std::vector<uint64_t> &indicies;
+		/** Position within #indicies of the next index to return. */
+		std::atomic<uint64_t> &position;
+	};
+
+	/** Portion of a TemplateArchive written by a single worker. */
+	struct TemplateArchiveSegment
+	{
+		/** Concatenated templates. */
+		std::ofstream archive{};
+		/** Manifest for #archive, in TemplateArchive#manifest format. */
+		std::ofstream manifest{};
+		/** Number of bytes written to #archive. */
+		uint64_t size{};
 	};
 
+	/**
+	 * @brief
+	 * Copy part of one file into another file at an offset.
+	 *
+	 * @param sourceFD
+	 * File descriptor open for reading.
+	 * @param sourceOffset
+	 * Offset within `sourceFD` of the first byte to copy.
+	 * @param size
+	 * Number of bytes to copy.
+	 * @param fd
+	 * File descriptor open for writing.
+	 * @param offset
+	 * Offset within `fd` at which to write.
+	 *
+	 * @return
+	 * true if all `size` bytes were copied, false otherwise.
+	 *
+	 * @note
+	 * Does not modify the file offset of either file descriptor, so may
+	 * be called from multiple threads at once.
+	 */
+	bool
+	copyAt(
+	    const int sourceFD,
+	    const uint64_t sourceOffset,
+	    const uint64_t size,
+	    const int fd,
+	    const uint64_t offset);
+
+	/**
+	 * @brief
+	 * Copy an entire file into another file at an offset.
+	 *
+	 * @param source
+	 * Path to the file to copy.
+	 * @param size
+	 * Number of bytes in `source`.
+	 * @param fd
+	 * File descriptor open for writing.
+	 * @param offset
+	 * Offset within `fd` at which to write the contents of `source`.
+	 *
+	 * @throw std::runtime_error
+	 * Error reading `source` or writing to `fd`.
+	 *
+	 * @note
+	 * Does not modify the file offset of `fd`, so may be called from
+	 * multiple threads at once.
+	 */
+	void
+	copyFileAt(
+	    const std::filesystem::path &source,
+	    const uint64_t size,
+	    const int fd,
+	    const uint64_t offset);
+
 	/**
 	 * @brief
 	 * Call the appropriate starting method based on the operation argument
@@ -78,6 +211,30 @@ namespace ELFT::Validation
 	dispatchOperation(
 	    const Arguments &args);
 
+	/**
+	 * @brief
+	 * Obtain the time createTemplate() is allowed to take for an
+	 * ImageSet.
+	 *
+	 * @param imageSet
+	 * Samples that will be passed to createTemplate().
+	 * @param templateType
+	 * Type of template that will be created.
+	 *
+	 * @return
+	 * Sum of `N * M` seconds over every sample in `imageSet`, as
+	 * described in ExtractionInterface::createTemplate().
+	 *
+	 * @note
+	 * Images are latent if their EFS says so or if `templateType` is
+	 * TemplateType::Probe and there is no EFS. Samples without an EFS
+	 * are treated as single fingers.
+	 */
+	std::chrono::milliseconds
+	getCreateTemplateTimeLimit(
+	    const Data::ImageSet &imageSet,
+	    const TemplateType templateType);
+
 	/**
 	 * @brief
 	 * Return an element from the appropriate Data::Validation vector.
@@ -149,6 +306,11 @@ namespace ELFT::Validation
 	 * @brief
 	 * Generate single-file archive of templates with manifest.
 	 *
+	 * @details
+	 * Templates are always archived in sorted path order. Offsets are
+	 * assigned up front from the template sizes, so templates are then
+	 * copied into the archive by multiple threads.
+	 *
 	 * @param args
 	 * Arguments parsed from command line.
 	 *
@@ -159,6 +321,104 @@ namespace ELFT::Validation
 	makeReferenceTemplateArchive(
 	    const Arguments &args);
 
+	/**
+	 * @brief
+	 * Obtain the name of the operation requested on the command line,
+	 * for use in the names of statistics files.
+	 *
+	 * @param args
+	 * Arguments parsed from command line.
+	 *
+	 * @return
+	 * Name of the operation (e.g., "extraction-1").
+	 */
+	std::string
+	getOperationName(
+	    const Arguments &args);
+
+	/**
+	 * @brief
+	 * Obtain the peak resident set size.
+	 *
+	 * @param children
+	 * Whether to obtain the largest peak of any child that has been
+	 * waited for instead of the peak of this process.
+	 *
+	 * @return
+	 * Peak resident set size, in KiB.
+	 *
+	 * @throw std::runtime_error
+	 * Error obtaining resource usage.
+	 */
+	uint64_t
+	getPeakResidentSetSize(
+	    const bool children = false);
+
+	/**
+	 * @brief
+	 * Obtain a unique identifier for the calling worker.
+	 *
+	 * @return
+	 * The process ID, followed by the thread number when running
+	 * multiple threads.
+	 */
+	std::string
+	getWorkerIdentifier();
+
+	/**
+	 * @brief
+	 * Obtain paths to a worker's TemplateArchive segment.
+	 *
+	 * @param args
+	 * Arguments parsed from command line.
+	 * @param worker
+	 * Unique identifier of the worker writing the segment.
+	 *
+	 * @return
+	 * Paths to the segment's archive and manifest.
+	 */
+	TemplateArchive
+	getTemplateArchiveSegment(
+	    const Arguments &args,
+	    const std::string &worker);
+
+	/**
+	 * @brief
+	 * Generate single-file archive of templates with manifest from
+	 * the TemplateArchive segments written during extraction.
+	 *
+	 * @details
+	 * Produces the same archive as makeReferenceTemplateArchive() would
+	 * from individual template files. Segments are removed on success.
+	 *
+	 * @param args
+	 * Arguments parsed from command line.
+	 *
+	 * @throw std::runtime_exception
+	 * Error reading or writing to disk.
+	 */
+	void
+	mergeTemplateArchiveSegments(
+	    const Arguments &args);
+
+	/**
+	 * @brief
+	 * Call a function once for every integer in `[0, count)` from
+	 * multiple threads.
+	 *
+	 * @param count
+	 * Number of times to call `fn`.
+	 * @param fn
+	 * Function to call.
+	 *
+	 * @throw
+	 * The first exception thrown by `fn`, after all threads stop.
+	 */
+	void
+	parallelFor(
+	    const uint64_t count,
+	    const std::function<void(const uint64_t)> &fn);
+
 	/**
 	 * @brief
 	 * Create a template from one or more images.
@@ -169,6 +429,11 @@ namespace ELFT::Validation
 	 * Element index in the ImageSet vector.
 	 * @param args
 	 * Arguments parsed from command line.
+	 * @param latencies
+	 * Where to record the time taken by createTemplate().
+	 * @param segment
+	 * Where to append the template. If nullptr, the template is written
+	 * to its own file.
 	 *
 	 * @return
 	 * Entry for log file.
@@ -180,7 +445,9 @@ namespace ELFT::Validation
 	performSingleCreate(
 	    const std::shared_ptr<ExtractionInterface> impl,
 	    const uint64_t imageIndex,
-	    const Arguments &args);
+	    const Arguments &args,
+	    LatencyRecorder &latencies,
+	    TemplateArchiveSegment *segment = nullptr);
 
 	/**
 	 * @brief
@@ -193,18 +460,51 @@ namespace ELFT::Validation
 	 * createTemplate().
 	 * @param p
 	 * Path to the template on disk.
+	 * @param latencies
+	 * Where to record the time taken by extractTemplateData().
+	 * @param log
+	 * Where to append entries for the log file.
 	 *
-	 * @return
-	 * Entries for log file.
+	 * @throw
+	 * Error reading image or creating template.
+	 */
+	void
+	performSingleExtractData(
+	    const std::shared_ptr<ExtractionInterface> impl,
+	    TemplateType templateType,
+	    const std::filesystem::path &p,
+	    LatencyRecorder &latencies,
+	    LogWriter &log);
+
+	/**
+	 * @brief
+	 * Extract data from created template.
+	 *
+	 * @param impl
+	 * Pointer to ELFT extraction implementation.
+	 * @param templateType
+	 * The type of template specified when the template was made during
+	 * createTemplate().
+	 * @param name
+	 * Name of the template, for the log file.
+	 * @param tmpl
+	 * Template data.
+	 * @param latencies
+	 * Where to record the time taken by extractTemplateData().
+	 * @param log
+	 * Where to append entries for the log file.
 	 *
 	 * @throw
 	 * Error reading image or creating template.
 	 */
-	std::string
+	void
 	performSingleExtractData(
 	    const std::shared_ptr<ExtractionInterface> impl,
 	    TemplateType templateType,
-	    const std::filesystem::path &p);
+	    const std::string &name,
+	    std::vector<std::byte> &&tmpl,
+	    LatencyRecorder &latencies,
+	    LogWriter &log);
 
 	/**
 	 * @brief
@@ -219,17 +519,22 @@ namespace ELFT::Validation
 	 * database.
 	 * @param maxCandidates
 	 * Maximum number of candidates to place in returned candidate list.
+	 * @param latencies
+	 * Where to record the time taken by search().
+	 * @param log
+	 * Where to append entries for the candidates log file.
 	 *
 	 * @return
-	 * A tuple containing the SearchResult and a string with entries for
-	 * the candidates log file.
+	 * The SearchResult, with candidates sorted by descending similarity.
 	 */
-	std::tuple<ELFT::SearchResult, std::string>
+	ELFT::SearchResult
 	performSingleSearch(
 	    const std::shared_ptr<SearchInterface> impl,
 	    const std::string &identifier,
 	    const std::vector<std::byte> &probeTemplate,
-	    const uint16_t maxCandidates);
+	    const uint16_t maxCandidates,
+	    LatencyRecorder &latencies,
+	    LogWriter &log);
 
 	/**
 	 * @brief
@@ -245,16 +550,19 @@ namespace ELFT::Validation
 	 * @param searchResult
 	 * SearchResult returned from SearchInterface::search for
 	 * `probeTemplate` with the currently loaded reference database.
-	 *
-	 * @return
-	 * Entries for log file.
+	 * @param latencies
+	 * Where to record the time taken by extractCorrespondence().
+	 * @param log
+	 * Where to append entries for the correspondence log file.
 	 */
-	std::string
+	void
 	performSingleSearchExtract(
 	    const std::shared_ptr<SearchInterface> impl,
 	    const std::string &identifier,
 	    const std::vector<std::byte> &probeTemplate,
-	    const SearchResult &searchResult);
+	    const SearchResult &searchResult,
+	    LatencyRecorder &latencies,
+	    LogWriter &log);
 
 	/**
 	 * @brief
@@ -273,6 +581,28 @@ namespace ELFT::Validation
 	    const uint64_t size,
 	    const uint64_t seed = std::random_device()());
 
+	/**
+	 * @brief
+	 * Make a log-able column of measurements reported by an
+	 * implementation about its own call.
+	 *
+	 * @param metrics
+	 * Value returned from getLastCallMetrics().
+	 * @param operation
+	 * Name of the call, as passed to LatencyRecorder::record().
+	 * @param latencies
+	 * Where to record the time taken by each reported stage.
+	 *
+	 * @return
+	 * Quoted, `;`-separated `name=value` pairs, with stage times in
+	 * microseconds suffixed by "us", or NA if nothing was reported.
+	 */
+	std::string
+	recordCallMetrics(
+	    const std::optional<CallMetrics> &metrics,
+	    const std::string &operation,
+	    LatencyRecorder &latencies);
+
 	/**
 	 * @brief
 	 * Read a file from disk.
@@ -311,17 +641,15 @@ namespace ELFT::Validation
 	 * @brief
 	 * Have implementation create reference database on disk.
 	 *
-	 * @param impl
-	 * Pointer to ELFT API implementation for extraction.
 	 * @param args
 	 * Arguments parsed from command line.
 	 *
 	 * @return
-	 * EXIT_SUCCESS if `impl` was successful. EXIT_FAILURE otherwise.
+	 * EXIT_SUCCESS if the implementation was successful. EXIT_FAILURE
+	 * otherwise.
 	 */
 	int
 	runCreateReferenceDatabase(
-	    std::shared_ptr<ExtractionInterface> impl,
 	    const Arguments &args);
 
 	/**
@@ -332,15 +660,21 @@ namespace ELFT::Validation
 	 * Pointer to ELFT API implementation for extraction.
 	 * @param indicies
 	 * The indicies from Data::Latents or Data::References from which to
-	 * create templates.
+	 * create templates, shared with other workers.
 	 * @param args
 	 * Arguments parsed from command line.
+	 * @param latencies
+	 * Where to record the time taken by each call.
+	 *
+	 * @return
+	 * The indicies from `indicies` that were taken by this worker.
 	 */
-	void
+	std::vector<uint64_t>
 	runExtractionCreate(
 	    std::shared_ptr<ExtractionInterface> impl,
-	    const std::vector<uint64_t> &indicies,
-	    const Arguments &args);
+	    IndexQueue &indicies,
+	    const Arguments &args,
+	    LatencyRecorder &latencies);
 
 	/**
 	 * @brief
@@ -354,12 +688,15 @@ namespace ELFT::Validation
 	 * create templates.
 	 * @param args
 	 * Arguments parsed from command line.
+	 * @param latencies
+	 * Where to record the time taken by each call.
 	 */
 	void
 	runExtractionExtractData(
 	    std::shared_ptr<ExtractionInterface> impl,
 	    const std::vector<uint64_t> &indicies,
-	    const Arguments &args);
+	    const Arguments &args,
+	    LatencyRecorder &latencies);
 
 	/**
 	 * @brief
@@ -369,14 +706,77 @@ namespace ELFT::Validation
 	 * Pointer to ELFT API implementation for searching.
 	 * @param indicies
 	 * The indicies from Data::Latents whose corresponding templates should
-	 * be searched.
+	 * be searched, shared with other workers.
 	 * @param args
 	 * Arguments parsed from command line.
+	 * @param latencies
+	 * Where to record the time taken by each call.
 	 */
 	void
 	runSearch(
 	    std::shared_ptr<SearchInterface> impl,
-	    const std::vector<uint64_t> &indicies,
+	    IndexQueue &indicies,
+	    const Arguments &args,
+	    LatencyRecorder &latencies);
+
+	/**
+	 * @brief
+	 * Run the operation requested on the command line in this worker.
+	 *
+	 * @param impl
+	 * Pointer to the ELFT API implementation for the operation.
+	 * @param indicies
+	 * Indicies shared with other workers.
+	 * @param args
+	 * Arguments parsed from command line.
+	 */
+	void
+	runOperation(
+	    const Implementation &impl,
+	    IndexQueue &indicies,
+	    const Arguments &args);
+
+	/**
+	 * @brief
+	 * Run searches once for each memory budget in
+	 * Arguments#loadSizeSweep.
+	 *
+	 * @param args
+	 * Arguments parsed from command line.
+	 *
+	 * @throw std::runtime_error
+	 * Error running or logging any search.
+	 *
+	 * @note
+	 * Each budget is run in its own child process, so that memory and
+	 * load() time are not carried over from other budgets. Logs for each
+	 * budget are written to a subdirectory of Arguments#outputDir named
+	 * for the budget, and one line per budget is collected in
+	 * loadSweep.log.
+	 */
+	void
+	runLoadSizeSweep(
+	    const Arguments &args);
+
+	/**
+	 * @brief
+	 * Run the operation requested on the command line from
+	 * Arguments#numThreads threads sharing one implementation.
+	 *
+	 * @param impl
+	 * Pointer to the ELFT API implementation for the operation.
+	 * @param indicies
+	 * Indicies shared with other workers.
+	 * @param args
+	 * Arguments parsed from command line.
+	 *
+	 * @throw
+	 * The first exception thrown by any thread, after all threads stop.
+	 */
+	void
+	runThreads(
+	    const Implementation &impl,
+	    IndexQueue &indicies,
 	    const Arguments &args);
 
 	/**
@@ -402,24 +802,87 @@ namespace ELFT::Validation
 
 	/**
 	 * @brief
-	 * Create multiple smaller sets from a large set.
+	 * Start counting events for the calling worker, if requested.
+	 *
+	 * @note
+	 * Does nothing unless Arguments#perfCounters was set when the
+	 * calling worker started.
+	 */
+	void
+	startPerformanceCounters();
+
+	/**
+	 * @brief
+	 * Stop counting events for the calling worker and record them, if
+	 * requested.
+	 *
+	 * @param operation
+	 * Name of the call, as passed to LatencyRecorder::record().
+	 * @param identifier
+	 * Identifier of the template or image set the call was made on.
+	 * @param latencies
+	 * Where to record events counted during the call.
+	 *
+	 * @throw std::runtime_error
+	 * Error writing to the worker's event log.
 	 *
-	 * @param combinedSet
-	 * Set of numbers to split.
-	 * @param numSets
-	 * Number of sets to create.
+	 * @note
+	 * Does nothing unless Arguments#perfCounters was set when the
+	 * calling worker started.
+	 */
+	void
+	stopPerformanceCounters(
+	    const std::string &operation,
+	    const std::string &identifier,
+	    LatencyRecorder &latencies);
+
+	/**
+	 * @brief
+	 * Merge the latency histograms written by every worker and write
+	 * latency and time limit summaries.
+	 *
+	 * @param args
+	 * Arguments parsed from command line.
+	 * @param wallTime
+	 * Wall-clock time taken by all workers.
+	 * @param latencies
+	 * Calls recorded outside of any worker (e.g., getImplementation()).
 	 *
 	 * @return
-	 * Collection of numSets collections, created sequentially
-	 * from combinedSet.
+	 * All calls recorded, from `latencies` and every worker.
 	 *
-	 * @throw
-	 * numSets > combinedSet.size()
+	 * @throw std::runtime_error
+	 * Error reading histograms or writing summary.
+	 *
+	 * @note
+	 * Individual worker histograms are removed once merged. Calls that
+	 * exceeded their time limit are reported on standard error.
 	 */
-	std::vector<std::vector<uint64_t>>
-	splitSet(
-	    const std::vector<uint64_t> &combinedSet,
-	    const uint8_t numSets);
+	LatencyRecorder
+	summarizeLatencies(
+	    const Arguments &args,
+	    const std::chrono::steady_clock::duration wallTime,
+	    LatencyRecorder latencies = {});
+
+	/**
+	 * @brief
+	 * Combine the trace spans written by every worker and the calling
+	 * thread into one trace.
+	 *
+	 * @param args
+	 * Arguments parsed from command line.
+	 *
+	 * @throw std::runtime_error
+	 * Error reading spans or writing trace.
+	 *
+	 * @note
+	 * Writes trace-<operation>.json, in Chrome trace-event format, and
+	 * removes the individual worker span files. Does nothing unless
+	 * Arguments#trace is set.
+	 */
+	void
+	summarizeTrace(
+	    const Arguments &args);
 
 	/**
 	 * @brief
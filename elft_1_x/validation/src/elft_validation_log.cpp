@@ -0,0 +1,222 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <elft_validation_log.h>
+#include <elft_validation_trace.h>
+
+namespace
+{
+	/** Smallest buffer, large enough for any single formatted value. */
+	constexpr std::size_t MinimumBufferSize{4096};
+
+	/**
+	 * @return
+	 * Description of the current value of errno.
+	 */
+	std::string
+	errnoMessage()
+	{
+		return (std::system_error(errno, std::system_category()).
+		    code().message());
+	}
+}
+
+ELFT::Validation::LogWriter::LogWriter(
+    const std::filesystem::path &path,
+    const std::size_t bufferSize) :
+    path{path},
+    bufferSize{std::max(bufferSize, MinimumBufferSize)},
+    active(this->bufferSize),
+    pending(this->bufferSize)
+{
+	this->fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC |
+	    O_CLOEXEC, 0666);
+	if (this->fd == -1)
+		throw std::runtime_error("Could not open " + path.string() +
+		    " (" + errnoMessage() + ")");
+
+	this->flusher = std::thread(&LogWriter::flush, this);
+}
+
+ELFT::Validation::LogWriter&
+ELFT::Validation::LogWriter::operator<<(
+    const std::string_view text)
+{
+	std::string_view::size_type offset{};
+	while (offset < text.size()) {
+		if (this->used == this->bufferSize)
+			this->submit();
+
+		const auto count = std::min(text.size() - offset,
+		    this->bufferSize - this->used);
+		std::memcpy(this->active.data() + this->used,
+		    text.data() + offset, count);
+		this->used += count;
+		offset += count;
+	}
+
+	return (*this);
+}
+
+ELFT::Validation::LogWriter&
+ELFT::Validation::LogWriter::operator<<(
+    const char *text)
+{
+	return (*this << std::string_view(text));
+}
+
+ELFT::Validation::LogWriter&
+ELFT::Validation::LogWriter::operator<<(
+    const char c)
+{
+	*this->reserve(1) = c;
+	++this->used;
+
+	return (*this);
+}
+
+ELFT::Validation::LogWriter&
+ELFT::Validation::LogWriter::operator<<(
+    const bool value)
+{
+	return (*this << (value ? '1' : '0'));
+}
+
+ELFT::Validation::LogWriter&
+ELFT::Validation::LogWriter::operator<<(
+    const double value)
+{
+	/* Largest finite double in fixed notation, plus sign and decimals */
+	static constexpr std::size_t maxLength{
+	    std::numeric_limits<double>::max_exponent10 + 9};
+
+	char *first = this->reserve(maxLength);
+	const char *last = std::to_chars(first, this->active.data() +
+	    this->active.size(), value, std::chars_format::fixed, 6).ptr;
+	this->used += static_cast<std::size_t>(last - first);
+
+	return (*this);
+}
+
+char*
+ELFT::Validation::LogWriter::reserve(
+    const std::size_t size)
+{
+	if ((this->bufferSize - this->used) < size)
+		this->submit();
+
+	return (this->active.data() + this->used);
+}
+
+void
+ELFT::Validation::LogWriter::submit()
+{
+	/* Only visible in traces when waiting on the previous buffer */
+	const TraceSpan span{"write log", "io"};
+
+	std::unique_lock lock{this->mutex};
+	this->changed.wait(lock, [this]() { return (!this->pendingReady); });
+	if (!this->error.empty())
+		throw std::runtime_error(this->error);
+
+	std::swap(this->active, this->pending);
+	this->pendingSize = this->used;
+	this->pendingReady = true;
+	this->used = 0;
+
+	lock.unlock();
+	this->changed.notify_all();
+}
+
+void
+ELFT::Validation::LogWriter::flush()
+{
+	std::unique_lock lock{this->mutex};
+	while (true) {
+		this->changed.wait(lock, [this]() {
+			return (this->pendingReady || this->stopping);
+		});
+		if (!this->pendingReady)
+			return;
+
+		/* Caller does not touch the pending buffer until released */
+		lock.unlock();
+		std::string writeError{};
+		std::size_t offset{};
+		while (offset < this->pendingSize) {
+			const auto count = ::write(this->fd,
+			    this->pending.data() + offset,
+			    this->pendingSize - offset);
+			if (count == -1) {
+				if (errno == EINTR)
+					continue;
+				writeError = "Error writing to " +
+				    this->path.string() + " (" +
+				    errnoMessage() + ")";
+				break;
+			}
+			offset += static_cast<std::size_t>(count);
+		}
+		lock.lock();
+
+		if (this->error.empty())
+			this->error = writeError;
+		this->pendingReady = false;
+		this->changed.notify_all();
+	}
+}
+
+void
+ELFT::Validation::LogWriter::close()
+{
+	if (this->fd == -1)
+		return;
+
+	std::string closeError{};
+	try {
+		if (this->used > 0)
+			this->submit();
+	} catch (const std::exception &e) {
+		closeError = e.what();
+	}
+
+	{
+		std::lock_guard lock{this->mutex};
+		this->stopping = true;
+	}
+	this->changed.notify_all();
+	this->flusher.join();
+
+	if (::close(this->fd) == -1 && closeError.empty())
+		closeError = "Error closing " + this->path.string() + " (" +
+		    errnoMessage() + ")";
+	this->fd = -1;
+
+	if (closeError.empty())
+		closeError = this->error;
+	if (!closeError.empty())
+		throw std::runtime_error(closeError);
+}
+
+ELFT::Validation::LogWriter::~LogWriter()
+{
+	try {
+		this->close();
+	} catch (...) {}
+}
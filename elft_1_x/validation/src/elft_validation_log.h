@@ -0,0 +1,186 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef ELFT_VALIDATION_LOG_H_
+#define ELFT_VALIDATION_LOG_H_
+
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ELFT::Validation
+{
+	/**
+	 * @brief
+	 * Text file written by a background thread.
+	 *
+	 * @details
+	 * Values are formatted with std::to_chars directly into one of two
+	 * preallocated buffers. When a buffer fills, it is handed to a
+	 * background thread to be written while the other is filled, so
+	 * callers only wait on storage when they produce text faster than it
+	 * can be written.
+	 */
+	class LogWriter
+	{
+	public:
+		/** Default size of each buffer, in bytes. */
+		static constexpr std::size_t DefaultBufferSize{1024 * 1024};
+
+		/**
+		 * @brief
+		 * LogWriter constructor.
+		 *
+		 * @param path
+		 * File to create or truncate.
+		 * @param bufferSize
+		 * Size of each of the two buffers, in bytes. At least 4 KiB
+		 * is always used.
+		 *
+		 * @throw std::runtime_error
+		 * `path` could not be opened.
+		 */
+		LogWriter(
+		    const std::filesystem::path &path,
+		    const std::size_t bufferSize = DefaultBufferSize);
+
+		/** Append text. */
+		LogWriter&
+		operator<<(
+		    const std::string_view text);
+
+		/** Append text. */
+		LogWriter&
+		operator<<(
+		    const char *text);
+
+		/** Append a single character. */
+		LogWriter&
+		operator<<(
+		    const char c);
+
+		/** Append 1 or 0. */
+		LogWriter&
+		operator<<(
+		    const bool value);
+
+		/** Append with six decimal places, as std::to_string. */
+		LogWriter&
+		operator<<(
+		    const double value);
+
+		/** Append the decimal representation of an integer. */
+		template<typename T, typename std::enable_if_t<
+		    std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+		    !std::is_same_v<T, char>, int> = 0>
+		LogWriter&
+		operator<<(
+		    const T value)
+		{
+			/* Every digit, plus a sign */
+			char *first = this->reserve(
+			    std::numeric_limits<T>::digits10 + 2);
+			const char *last = std::to_chars(first,
+			    this->active.data() + this->active.size(),
+			    value).ptr;
+			this->used += static_cast<std::size_t>(last - first);
+			return (*this);
+		}
+
+		/**
+		 * @brief
+		 * Write all appended text and close the file.
+		 *
+		 * @throw std::runtime_error
+		 * Error writing or closing the file.
+		 *
+		 * @note
+		 * Nothing may be appended afterwards.
+		 */
+		void
+		close();
+
+		/** Close the file, ignoring errors. */
+		~LogWriter();
+
+		/** @cond SUPPRESS_FROM_DOXYGEN */
+		LogWriter(const LogWriter&) = delete;
+		LogWriter& operator=(const LogWriter&) = delete;
+		/** @endcond */
+
+	private:
+		/**
+		 * @brief
+		 * Obtain space at the end of #active.
+		 *
+		 * @param size
+		 * Number of bytes needed, no larger than #bufferSize.
+		 *
+		 * @return
+		 * Pointer to at least `size` writable bytes.
+		 */
+		char*
+		reserve(
+		    const std::size_t size);
+
+		/**
+		 * @brief
+		 * Hand #active to #flusher and continue with the free buffer.
+		 *
+		 * @throw std::runtime_error
+		 * A previous write failed.
+		 */
+		void
+		submit();
+
+		/** Body of #flusher. */
+		void
+		flush();
+
+		/** Path of the file, for error messages. */
+		const std::filesystem::path path;
+		/** Size of each buffer. */
+		const std::size_t bufferSize;
+		/** File descriptor of the open file, or -1 once closed. */
+		int fd{-1};
+
+		/** Buffer being appended to. */
+		std::vector<char> active{};
+		/** Number of bytes appended to #active. */
+		std::size_t used{};
+		/** Buffer being written by #flusher, or free. */
+		std::vector<char> pending{};
+		/** Number of bytes of #pending to write. */
+		std::size_t pendingSize{};
+		/** Whether #pending is waiting to be or being written. */
+		bool pendingReady{false};
+		/** Whether #flusher should exit once #pending is written. */
+		bool stopping{false};
+		/** Description of the first write error. */
+		std::string error{};
+
+		/** Guards the members shared with #flusher. */
+		std::mutex mutex{};
+		/** Signaled when #pendingReady or #stopping changes. */
+		std::condition_variable changed{};
+		/** Thread writing #pending. */
+		std::thread flusher{};
+	};
+}
+
+#endif /* ELFT_VALIDATION_LOG_H_ */
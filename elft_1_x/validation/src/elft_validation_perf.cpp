@@ -0,0 +1,146 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <elft_validation_perf.h>
+
+namespace
+{
+	/** Event names, in the order of ELFT::Validation::PerformanceEvent. */
+	constexpr std::array<const char*,
+	    ELFT::Validation::PerformanceEventCount> EventNames{"cycles",
+	    "instructions", "LLC misses", "branch misses", "page faults"};
+
+	/**
+	 * @brief
+	 * Open a counter for the calling thread and threads it creates.
+	 *
+	 * @param type
+	 * perf_event_attr::type.
+	 * @param config
+	 * perf_event_attr::config.
+	 *
+	 * @return
+	 * File descriptor of the disabled counter, or -1 on error.
+	 */
+	int
+	openCounter(
+	    const uint32_t type,
+	    const uint64_t config)
+	{
+		struct perf_event_attr attr{};
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.inherit = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		return (static_cast<int>(::syscall(SYS_perf_event_open, &attr,
+		    0, -1, -1, PERF_FLAG_FD_CLOEXEC)));
+	}
+}
+
+ELFT::Validation::PerformanceCounters::PerformanceCounters()
+{
+	static constexpr std::array<std::pair<uint32_t, uint64_t>,
+	    PerformanceEventCount> events{{
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+		{PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}
+	}};
+
+	for (std::size_t i{}; i < PerformanceEventCount; ++i) {
+		this->fds[i] = openCounter(events[i].first, events[i].second);
+		if (this->fds[i] == -1)
+			this->errors[i] = std::system_error(errno,
+			    std::system_category()).code().message();
+	}
+}
+
+void
+ELFT::Validation::PerformanceCounters::start()
+{
+	/*
+	 * Counts from exited threads are not cleared by
+	 * PERF_EVENT_IOC_RESET, so calls are measured as differences.
+	 */
+	this->initial = this->read();
+	for (const auto &fd : this->fds)
+		if (fd != -1)
+			::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+ELFT::Validation::PerformanceEventCounts
+ELFT::Validation::PerformanceCounters::stop()
+{
+	for (const auto &fd : this->fds)
+		if (fd != -1)
+			::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+	auto counts = this->read();
+	for (std::size_t i{}; i < PerformanceEventCount; ++i) {
+		if (counts[i] && this->initial[i])
+			*counts[i] -= *this->initial[i];
+		else
+			counts[i].reset();
+	}
+
+	return (counts);
+}
+
+ELFT::Validation::PerformanceEventCounts
+ELFT::Validation::PerformanceCounters::read()
+    const
+{
+	PerformanceEventCounts counts{};
+	for (std::size_t i{}; i < PerformanceEventCount; ++i) {
+		if (this->fds[i] == -1)
+			continue;
+
+		uint64_t value{};
+		if (::read(this->fds[i], &value, sizeof(value)) ==
+		    static_cast<ssize_t>(sizeof(value)))
+			counts[i] = value;
+	}
+
+	return (counts);
+}
+
+std::vector<std::string>
+ELFT::Validation::PerformanceCounters::getUnavailable()
+    const
+{
+	std::vector<std::string> unavailable{};
+	for (std::size_t i{}; i < PerformanceEventCount; ++i)
+		if (this->fds[i] == -1)
+			unavailable.push_back(std::string(EventNames[i]) +
+			    " (" + this->errors[i] + ')');
+	return (unavailable);
+}
+
+ELFT::Validation::PerformanceCounters::~PerformanceCounters()
+{
+	for (const auto &fd : this->fds)
+		if (fd != -1)
+			::close(fd);
+}
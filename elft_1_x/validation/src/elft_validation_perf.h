@@ -0,0 +1,102 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef ELFT_VALIDATION_PERF_H_
+#define ELFT_VALIDATION_PERF_H_
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <elft_validation_stats.h>
+
+namespace ELFT::Validation
+{
+	/**
+	 * @brief
+	 * Hardware and software event counters from perf_event_open(2).
+	 *
+	 * @details
+	 * Counters follow the thread that constructs this object and any
+	 * threads that thread creates afterward. Counts from a created
+	 * thread are included once that thread exits, so a call is charged
+	 * for threads it creates only if they exit before it returns. Work
+	 * done on threads that outlive calls, or that were created by
+	 * another thread (e.g., a pool an implementation starts in load()),
+	 * is not counted. Only user-space events are counted.
+	 */
+	class PerformanceCounters
+	{
+	public:
+		/**
+		 * @brief
+		 * PerformanceCounters constructor.
+		 *
+		 * @note
+		 * Events that cannot be counted on this system (e.g., in a
+		 * virtual machine without a PMU, or when restricted by
+		 * perf_event_paranoid) are skipped. See getUnavailable().
+		 */
+		PerformanceCounters();
+
+		/**
+		 * @brief
+		 * Note the current counts and start all counters.
+		 */
+		void
+		start();
+
+		/**
+		 * @brief
+		 * Stop all counters.
+		 *
+		 * @return
+		 * Events counted since start(), with no value for events
+		 * that could not be counted.
+		 */
+		PerformanceEventCounts
+		stop();
+
+		/**
+		 * @return
+		 * Names of events that could not be counted, and why.
+		 */
+		std::vector<std::string>
+		getUnavailable()
+		    const;
+
+		~PerformanceCounters();
+
+		/** @cond SUPPRESS_FROM_DOXYGEN */
+		PerformanceCounters(const PerformanceCounters&) = delete;
+		PerformanceCounters& operator=(
+		    const PerformanceCounters&) = delete;
+		/** @endcond */
+
+	private:
+		/**
+		 * @return
+		 * Current value of each counter, with no value for events
+		 * that could not be counted or read.
+		 */
+		PerformanceEventCounts
+		read()
+		    const;
+
+		/** Counts when start() was last called. */
+		PerformanceEventCounts initial{};
+		/** File descriptor for each event, or -1 if unavailable. */
+		std::array<int, PerformanceEventCount> fds{};
+		/** Error opening each event, if any. */
+		std::array<std::string, PerformanceEventCount> errors{};
+	};
+}
+
+#endif /* ELFT_VALIDATION_PERF_H_ */
@@ -0,0 +1,643 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <elft_validation_stats.h>
+
+std::size_t
+ELFT::Validation::LatencyHistogram::getBucket(
+    const uint64_t value)
+{
+	/* Small values are counted exactly */
+	if (value < (uint64_t{1} << (SubBucketBits + 1)))
+		return (static_cast<std::size_t>(value));
+
+	/* Keep the SubBucketBits + 1 most significant bits */
+	const auto msb = static_cast<unsigned int>(63 - __builtin_clzll(value));
+	const auto shift = msb - SubBucketBits;
+	return ((static_cast<std::size_t>(shift) << SubBucketBits) +
+	    static_cast<std::size_t>(value >> shift));
+}
+
+uint64_t
+ELFT::Validation::LatencyHistogram::getBucketMaximum(
+    const std::size_t bucket)
+{
+	if (bucket < (std::size_t{1} << (SubBucketBits + 1)))
+		return (bucket);
+
+	const auto shift = (bucket >> SubBucketBits) - 1;
+	const auto mantissa = bucket - (shift << SubBucketBits);
+	return (((static_cast<uint64_t>(mantissa) + 1) << shift) - 1);
+}
+
+void
+ELFT::Validation::LatencyHistogram::record(
+    const uint64_t microseconds)
+{
+	++this->counts[getBucket(microseconds)];
+	++this->count;
+	this->sum += microseconds;
+	this->maximum = std::max(this->maximum, microseconds);
+}
+
+void
+ELFT::Validation::LatencyHistogram::merge(
+    const LatencyHistogram &other)
+{
+	for (std::size_t i{}; i < BucketCount; ++i)
+		this->counts[i] += other.counts[i];
+	this->count += other.count;
+	this->sum += other.sum;
+	this->maximum = std::max(this->maximum, other.maximum);
+}
+
+uint64_t
+ELFT::Validation::LatencyHistogram::getCount()
+    const
+{
+	return (this->count);
+}
+
+uint64_t
+ELFT::Validation::LatencyHistogram::getMaximum()
+    const
+{
+	return (this->maximum);
+}
+
+double
+ELFT::Validation::LatencyHistogram::getMean()
+    const
+{
+	if (this->count == 0)
+		return (0);
+	return (static_cast<double>(this->sum) /
+	    static_cast<double>(this->count));
+}
+
+uint64_t
+ELFT::Validation::LatencyHistogram::getPercentile(
+    const double percentile)
+    const
+{
+	if (this->count == 0)
+		return (0);
+
+	/* Rank of the call at this percentile, counting from 1 */
+	const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(
+	    std::ceil((std::clamp(percentile, 0.0, 100.0) / 100.0) *
+	    static_cast<double>(this->count))));
+
+	uint64_t seen{};
+	for (std::size_t i{}; i < BucketCount; ++i) {
+		seen += this->counts[i];
+		if (seen >= rank)
+			return (std::min(getBucketMaximum(i), this->maximum));
+	}
+
+	return (this->maximum);
+}
+
+std::string
+ELFT::Validation::LatencyHistogram::serialize()
+    const
+{
+	std::string line{std::to_string(this->count) + ' ' +
+	    std::to_string(this->sum) + ' ' + std::to_string(this->maximum)};
+	for (std::size_t i{}; i < BucketCount; ++i)
+		if (this->counts[i] != 0)
+			line += ' ' + std::to_string(i) + ':' +
+			    std::to_string(this->counts[i]);
+	return (line);
+}
+
+ELFT::Validation::LatencyHistogram
+ELFT::Validation::LatencyHistogram::parse(
+    const std::string &line)
+{
+	LatencyHistogram histogram{};
+	std::istringstream ss{line};
+	if (!(ss >> histogram.count >> histogram.sum >> histogram.maximum))
+		throw std::runtime_error{"Malformed latency histogram"};
+
+	std::string token{};
+	uint64_t total{};
+	while (ss >> token) {
+		const auto colon = token.find(':');
+		if (colon == std::string::npos)
+			throw std::runtime_error{"Malformed latency histogram "
+			    "bucket: " + token};
+
+		std::size_t bucket{};
+		uint64_t bucketCount{};
+		try {
+			bucket = std::stoull(token.substr(0, colon));
+			bucketCount = std::stoull(token.substr(colon + 1));
+		} catch (const std::exception&) {
+			throw std::runtime_error{"Malformed latency histogram "
+			    "bucket: " + token};
+		}
+		if (bucket >= BucketCount)
+			throw std::runtime_error{"Malformed latency histogram "
+			    "bucket: " + token};
+
+		histogram.counts[bucket] += bucketCount;
+		total += bucketCount;
+	}
+	if (total != histogram.count)
+		throw std::runtime_error{"Latency histogram counts do not "
+		    "match total"};
+
+	return (histogram);
+}
+
+void
+ELFT::Validation::TimeLimitTally::record(
+    const uint64_t microseconds,
+    const uint64_t limitMicroseconds)
+{
+	const auto margin = static_cast<int64_t>(limitMicroseconds) -
+	    static_cast<int64_t>(microseconds);
+	this->worstMargin = (this->count == 0) ? margin :
+	    std::min(this->worstMargin, margin);
+
+	++this->count;
+	if (microseconds > limitMicroseconds)
+		++this->violations;
+	this->sum += microseconds;
+	this->limitSum += limitMicroseconds;
+}
+
+void
+ELFT::Validation::TimeLimitTally::merge(
+    const TimeLimitTally &other)
+{
+	if (other.count == 0)
+		return;
+
+	this->worstMargin = (this->count == 0) ? other.worstMargin :
+	    std::min(this->worstMargin, other.worstMargin);
+	this->count += other.count;
+	this->violations += other.violations;
+	this->sum += other.sum;
+	this->limitSum += other.limitSum;
+}
+
+uint64_t
+ELFT::Validation::TimeLimitTally::getCount()
+    const
+{
+	return (this->count);
+}
+
+uint64_t
+ELFT::Validation::TimeLimitTally::getViolations()
+    const
+{
+	return (this->violations);
+}
+
+double
+ELFT::Validation::TimeLimitTally::getMean()
+    const
+{
+	if (this->count == 0)
+		return (0);
+	return (static_cast<double>(this->sum) /
+	    static_cast<double>(this->count));
+}
+
+double
+ELFT::Validation::TimeLimitTally::getMeanLimit()
+    const
+{
+	if (this->count == 0)
+		return (0);
+	return (static_cast<double>(this->limitSum) /
+	    static_cast<double>(this->count));
+}
+
+int64_t
+ELFT::Validation::TimeLimitTally::getWorstMargin()
+    const
+{
+	return (this->worstMargin);
+}
+
+std::string
+ELFT::Validation::TimeLimitTally::serialize()
+    const
+{
+	return (std::to_string(this->count) + ' ' +
+	    std::to_string(this->violations) + ' ' +
+	    std::to_string(this->sum) + ' ' +
+	    std::to_string(this->limitSum) + ' ' +
+	    std::to_string(this->worstMargin));
+}
+
+ELFT::Validation::TimeLimitTally
+ELFT::Validation::TimeLimitTally::parse(
+    const std::string &line)
+{
+	TimeLimitTally tally{};
+	std::istringstream ss{line};
+	if (!(ss >> tally.count >> tally.violations >> tally.sum >>
+	    tally.limitSum >> tally.worstMargin))
+		throw std::runtime_error{"Malformed time limit tally"};
+	if (tally.violations > tally.count)
+		throw std::runtime_error{"Time limit tally has more violations "
+		    "than calls"};
+
+	return (tally);
+}
+
+std::string
+ELFT::Validation::formatPerformanceEvents(
+    const PerformanceEventCounts &counts)
+{
+	std::string columns{};
+	for (const auto &count : counts)
+		columns += (count ? std::to_string(*count) : "NA") + ',';
+	columns.pop_back();
+	return (columns);
+}
+
+void
+ELFT::Validation::PerformanceEventTally::record(
+    const PerformanceEventCounts &counts)
+{
+	++this->count;
+	for (std::size_t i{}; i < PerformanceEventCount; ++i) {
+		if (!counts[i])
+			continue;
+		this->sums[i] += *counts[i];
+		++this->counted[i];
+	}
+}
+
+void
+ELFT::Validation::PerformanceEventTally::merge(
+    const PerformanceEventTally &other)
+{
+	this->count += other.count;
+	for (std::size_t i{}; i < PerformanceEventCount; ++i) {
+		this->sums[i] += other.sums[i];
+		this->counted[i] += other.counted[i];
+	}
+}
+
+uint64_t
+ELFT::Validation::PerformanceEventTally::getCount()
+    const
+{
+	return (this->count);
+}
+
+std::optional<uint64_t>
+ELFT::Validation::PerformanceEventTally::getSum(
+    const PerformanceEvent event)
+    const
+{
+	const auto i = static_cast<std::size_t>(event);
+	if ((this->count == 0) || (this->counted[i] != this->count))
+		return {};
+	return (this->sums[i]);
+}
+
+std::string
+ELFT::Validation::PerformanceEventTally::serialize()
+    const
+{
+	std::string line{std::to_string(this->count)};
+	for (std::size_t i{}; i < PerformanceEventCount; ++i)
+		line += ' ' + std::to_string(this->sums[i]) + ':' +
+		    std::to_string(this->counted[i]);
+	return (line);
+}
+
+ELFT::Validation::PerformanceEventTally
+ELFT::Validation::PerformanceEventTally::parse(
+    const std::string &line)
+{
+	PerformanceEventTally tally{};
+	std::istringstream ss{line};
+	if (!(ss >> tally.count))
+		throw std::runtime_error{"Malformed performance event tally"};
+
+	for (std::size_t i{}; i < PerformanceEventCount; ++i) {
+		char colon{};
+		if (!(ss >> tally.sums[i] >> colon >> tally.counted[i]) ||
+		    (colon != ':') || (tally.counted[i] > tally.count))
+			throw std::runtime_error{"Malformed performance event "
+			    "tally"};
+	}
+
+	return (tally);
+}
+
+ELFT::Validation::ResourceUsage
+ELFT::Validation::ResourceUsage::sample(
+    const bool beforeCall)
+{
+	ResourceUsage usage{};
+
+	const auto readCPUTime = [&usage]() {
+		struct timespec cpu{};
+		if (::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu) != 0)
+			throw std::runtime_error{"Could not obtain processor "
+			    "time: " + std::system_error(errno,
+			    std::system_category()).code().message()};
+		usage.cpuTime = (static_cast<uint64_t>(cpu.tv_sec) * 1000000) +
+		    (static_cast<uint64_t>(cpu.tv_nsec) / 1000);
+	};
+	if (!beforeCall)
+		readCPUTime();
+
+	std::error_code ec{};
+	for (std::filesystem::directory_iterator it{"/proc/self/task", ec}, end;
+	    !ec && (it != end); it.increment(ec))
+		++usage.threads;
+
+	/* May be unreadable, depending on kernel configuration */
+	std::ifstream io{"/proc/self/io"};
+	std::string key{};
+	uint64_t value{};
+	while (io >> key >> value) {
+		if (key == "read_bytes:")
+			usage.readBytes = value;
+		else if (key == "write_bytes:")
+			usage.writtenBytes = value;
+	}
+
+	/* Second field is resident pages */
+	std::ifstream statm{"/proc/self/statm"};
+	uint64_t pages{};
+	if (!(statm >> pages >> pages))
+		throw std::runtime_error{"Could not read /proc/self/statm"};
+	usage.residentSetSize = (pages * static_cast<uint64_t>(
+	    ::sysconf(_SC_PAGESIZE))) / 1024;
+
+	if (beforeCall)
+		readCPUTime();
+
+	return (usage);
+}
+
+std::string
+ELFT::Validation::formatResourceUsage(
+    const ResourceUsage &before,
+    const ResourceUsage &after)
+{
+	const auto delta = [](const std::optional<uint64_t> &first,
+	    const std::optional<uint64_t> &second) -> std::string {
+		if (!first || !second)
+			return ("NA");
+		return (std::to_string(*second - *first));
+	};
+
+	return (std::to_string(after.cpuTime - before.cpuTime) + ',' +
+	    std::to_string(after.threads) + ',' +
+	    delta(before.readBytes, after.readBytes) + ',' +
+	    delta(before.writtenBytes, after.writtenBytes) + ',' +
+	    std::to_string(static_cast<int64_t>(after.residentSetSize) -
+	    static_cast<int64_t>(before.residentSetSize)));
+}
+
+void
+ELFT::Validation::LatencyRecorder::record(
+    const std::string &operation,
+    const std::chrono::steady_clock::duration elapsed,
+    const std::optional<std::chrono::milliseconds> &limit)
+{
+	const auto microseconds = static_cast<uint64_t>(std::max<
+	    std::chrono::microseconds::rep>(0, std::chrono::duration_cast<
+	    std::chrono::microseconds>(elapsed).count()));
+
+	this->histograms[operation].record(microseconds);
+	if (limit)
+		this->timeLimits[operation].record(microseconds,
+		    static_cast<uint64_t>(std::chrono::duration_cast<
+		    std::chrono::microseconds>(*limit).count()));
+}
+
+void
+ELFT::Validation::LatencyRecorder::recordEvents(
+    const std::string &operation,
+    const PerformanceEventCounts &counts)
+{
+	this->events[operation].record(counts);
+}
+
+void
+ELFT::Validation::LatencyRecorder::merge(
+    const LatencyRecorder &other)
+{
+	for (const auto &[operation, histogram] : other.histograms)
+		this->histograms[operation].merge(histogram);
+	for (const auto &[operation, tally] : other.timeLimits)
+		this->timeLimits[operation].merge(tally);
+	for (const auto &[operation, tally] : other.events)
+		this->events[operation].merge(tally);
+}
+
+void
+ELFT::Validation::LatencyRecorder::write(
+    const std::filesystem::path &path)
+    const
+{
+	std::ofstream file{path, std::ios_base::out | std::ios_base::trunc};
+	if (!file)
+		throw std::runtime_error{"Could not open " + path.string()};
+
+	for (const auto &[operation, histogram] : this->histograms)
+		file << "latency\t" << operation << '\t' <<
+		    histogram.serialize() << '\n';
+	for (const auto &[operation, tally] : this->timeLimits)
+		file << "limit\t" << operation << '\t' << tally.serialize() <<
+		    '\n';
+	for (const auto &[operation, tally] : this->events)
+		file << "events\t" << operation << '\t' << tally.serialize() <<
+		    '\n';
+
+	file.close();
+	if (!file)
+		throw std::runtime_error{"Could not write " + path.string()};
+}
+
+ELFT::Validation::LatencyRecorder
+ELFT::Validation::LatencyRecorder::read(
+    const std::filesystem::path &path)
+{
+	std::ifstream file{path};
+	if (!file)
+		throw std::runtime_error{"Could not open " + path.string()};
+
+	LatencyRecorder recorder{};
+	std::string line{};
+	while (std::getline(file, line)) {
+		/* kind<TAB>operation<TAB>data */
+		const auto first = line.find('\t');
+		const auto second = (first == std::string::npos) ?
+		    std::string::npos : line.find('\t', first + 1);
+		if (second == std::string::npos)
+			throw std::runtime_error{"Malformed line in " +
+			    path.string()};
+		const auto kind = line.substr(0, first);
+		const auto operation = line.substr(first + 1,
+		    second - first - 1);
+		const auto data = line.substr(second + 1);
+
+		try {
+			if (kind == "latency")
+				recorder.histograms[operation].merge(
+				    LatencyHistogram::parse(data));
+			else if (kind == "limit")
+				recorder.timeLimits[operation].merge(
+				    TimeLimitTally::parse(data));
+			else if (kind == "events")
+				recorder.events[operation].merge(
+				    PerformanceEventTally::parse(data));
+			else
+				throw std::runtime_error{"Unknown kind of "
+				    "line: " + kind};
+		} catch (const std::exception &e) {
+			throw std::runtime_error{path.string() + ": " +
+			    e.what()};
+		}
+	}
+	if (file.bad())
+		throw std::runtime_error{"Could not read " + path.string()};
+
+	return (recorder);
+}
+
+std::string
+ELFT::Validation::LatencyRecorder::summarize(
+    const std::chrono::steady_clock::duration wallTime)
+    const
+{
+	const auto seconds = std::chrono::duration_cast<
+	    std::chrono::duration<double>>(wallTime).count();
+
+	std::stringstream ss{};
+	ss << "\"operation\",count,throughput,mean,p50,p90,p99,p99.9,max\n";
+	ss << std::fixed << std::setprecision(3);
+	for (const auto &[operation, histogram] : this->histograms) {
+		ss << '"' << operation << "\"," << histogram.getCount() <<
+		    ',';
+		if (seconds > 0)
+			ss << (static_cast<double>(histogram.getCount()) /
+			    seconds);
+		else
+			ss << "NA";
+		ss << ',' << histogram.getMean() << ',' <<
+		    histogram.getPercentile(50) << ',' <<
+		    histogram.getPercentile(90) << ',' <<
+		    histogram.getPercentile(99) << ',' <<
+		    histogram.getPercentile(99.9) << ',' <<
+		    histogram.getMaximum() << '\n';
+	}
+
+	return (ss.str());
+}
+
+std::string
+ELFT::Validation::LatencyRecorder::summarizeTimeLimits()
+    const
+{
+	std::stringstream ss{};
+	ss << "\"operation\",count,violations,worst_margin,mean,mean_limit,"
+	    "mean_margin\n";
+	ss << std::fixed << std::setprecision(3);
+	for (const auto &[operation, tally] : this->timeLimits)
+		ss << '"' << operation << "\"," << tally.getCount() << ',' <<
+		    tally.getViolations() << ',' << tally.getWorstMargin() <<
+		    ',' << tally.getMean() << ',' << tally.getMeanLimit() <<
+		    ',' << (tally.getMeanLimit() - tally.getMean()) << '\n';
+
+	return (ss.str());
+}
+
+std::string
+ELFT::Validation::LatencyRecorder::summarizeEvents()
+    const
+{
+	const auto column = [](const std::optional<uint64_t> &value) {
+		return (value ? std::to_string(*value) : std::string{"NA"});
+	};
+	/* Ratio of two totals, scaled */
+	const auto ratio = [](const std::optional<uint64_t> &numerator,
+	    const std::optional<uint64_t> &denominator, const double scale) {
+		if (!numerator || !denominator || (*denominator == 0))
+			return (std::string{"NA"});
+		std::stringstream ss{};
+		ss << std::fixed << std::setprecision(3) << (scale *
+		    static_cast<double>(*numerator) /
+		    static_cast<double>(*denominator));
+		return (ss.str());
+	};
+
+	std::stringstream ss{};
+	ss << "\"operation\",count,cycles,instructions,ipc,llc_misses,"
+	    "llc_mpki,branch_misses,branch_mpki,page_faults\n";
+	for (const auto &[operation, tally] : this->events) {
+		const auto cycles = tally.getSum(PerformanceEvent::Cycles);
+		const auto instructions = tally.getSum(
+		    PerformanceEvent::Instructions);
+		const auto cacheMisses = tally.getSum(
+		    PerformanceEvent::CacheMisses);
+		const auto branchMisses = tally.getSum(
+		    PerformanceEvent::BranchMisses);
+
+		ss << '"' << operation << "\"," << tally.getCount() << ',' <<
+		    column(cycles) << ',' << column(instructions) << ',' <<
+		    ratio(instructions, cycles, 1) << ',' <<
+		    column(cacheMisses) << ',' <<
+		    ratio(cacheMisses, instructions, 1000) << ',' <<
+		    column(branchMisses) << ',' <<
+		    ratio(branchMisses, instructions, 1000) << ',' <<
+		    column(tally.getSum(PerformanceEvent::PageFaults)) << '\n';
+	}
+
+	return (ss.str());
+}
+
+ELFT::Validation::LatencyHistogram
+ELFT::Validation::LatencyRecorder::getHistogram(
+    const std::string &operation)
+    const
+{
+	const auto it = this->histograms.find(operation);
+	if (it == this->histograms.cend())
+		return {};
+	return (it->second);
+}
+
+uint64_t
+ELFT::Validation::LatencyRecorder::getTimeLimitViolations()
+    const
+{
+	uint64_t violations{};
+	for (const auto &[operation, tally] : this->timeLimits)
+		violations += tally.getViolations();
+	return (violations);
+}
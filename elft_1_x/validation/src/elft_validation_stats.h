@@ -0,0 +1,633 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef ELFT_VALIDATION_STATS_H_
+#define ELFT_VALIDATION_STATS_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace ELFT::Validation
+{
+	/**
+	 * @brief
+	 * Histogram of latencies with bounded relative error.
+	 *
+	 * @details
+	 * Values below 128 microseconds are counted exactly. Larger values
+	 * are counted in logarithmically-sized buckets, each spanning 1/64
+	 * of a power of two, so every percentile is accurate to within
+	 * about 1.6%, no matter how long the call took.
+	 */
+	class LatencyHistogram
+	{
+	public:
+		/**
+		 * @brief
+		 * Count one call.
+		 *
+		 * @param microseconds
+		 * Time taken by the call.
+		 */
+		void
+		record(
+		    const uint64_t microseconds);
+
+		/**
+		 * @brief
+		 * Add all calls counted by another histogram.
+		 *
+		 * @param other
+		 * Histogram to add to this one.
+		 */
+		void
+		merge(
+		    const LatencyHistogram &other);
+
+		/**
+		 * @return
+		 * Number of calls counted.
+		 */
+		uint64_t
+		getCount()
+		    const;
+
+		/**
+		 * @return
+		 * Longest call counted, in microseconds.
+		 */
+		uint64_t
+		getMaximum()
+		    const;
+
+		/**
+		 * @return
+		 * Mean time taken by calls counted, in microseconds.
+		 */
+		double
+		getMean()
+		    const;
+
+		/**
+		 * @brief
+		 * Obtain a percentile.
+		 *
+		 * @param percentile
+		 * Percentile to obtain, in [0, 100].
+		 *
+		 * @return
+		 * Time in microseconds that `percentile` percent of calls
+		 * took no longer than. 0 if nothing has been counted.
+		 */
+		uint64_t
+		getPercentile(
+		    const double percentile)
+		    const;
+
+		/**
+		 * @brief
+		 * Convert to a single line of text.
+		 *
+		 * @return
+		 * Text that can be passed to parse().
+		 */
+		std::string
+		serialize()
+		    const;
+
+		/**
+		 * @brief
+		 * Convert the output of serialize() back to a histogram.
+		 *
+		 * @param line
+		 * Output of serialize().
+		 *
+		 * @return
+		 * Histogram represented by `line`.
+		 *
+		 * @throw std::runtime_error
+		 * `line` is malformed.
+		 */
+		static LatencyHistogram
+		parse(
+		    const std::string &line);
+
+	private:
+		/** Number of bits used to subdivide each power of two. */
+		static constexpr uint8_t SubBucketBits{6};
+		/** Number of buckets needed to cover any uint64_t. */
+		static constexpr std::size_t BucketCount{
+		    (64 - SubBucketBits + 1) << SubBucketBits};
+
+		/**
+		 * @return
+		 * Bucket that `value` is counted in.
+		 */
+		static std::size_t
+		getBucket(
+		    const uint64_t value);
+
+		/**
+		 * @return
+		 * Largest value counted in `bucket`.
+		 */
+		static uint64_t
+		getBucketMaximum(
+		    const std::size_t bucket);
+
+		/** Number of calls counted in each bucket. */
+		std::array<uint64_t, BucketCount> counts{};
+		/** Number of calls counted. */
+		uint64_t count{};
+		/** Sum of all values counted. */
+		uint64_t sum{};
+		/** Largest value counted. */
+		uint64_t maximum{};
+	};
+
+	/**
+	 * @brief
+	 * Comparison of calls against their time limits from elft.h.
+	 */
+	class TimeLimitTally
+	{
+	public:
+		/**
+		 * @brief
+		 * Count one call.
+		 *
+		 * @param microseconds
+		 * Time taken by the call.
+		 * @param limitMicroseconds
+		 * Time the call was allowed to take.
+		 */
+		void
+		record(
+		    const uint64_t microseconds,
+		    const uint64_t limitMicroseconds);
+
+		/**
+		 * @brief
+		 * Add all calls counted by another tally.
+		 *
+		 * @param other
+		 * Tally to add to this one.
+		 */
+		void
+		merge(
+		    const TimeLimitTally &other);
+
+		/**
+		 * @return
+		 * Number of calls counted.
+		 */
+		uint64_t
+		getCount()
+		    const;
+
+		/**
+		 * @return
+		 * Number of calls that took longer than their limit.
+		 */
+		uint64_t
+		getViolations()
+		    const;
+
+		/**
+		 * @return
+		 * Mean time taken by calls counted, in microseconds.
+		 */
+		double
+		getMean()
+		    const;
+
+		/**
+		 * @return
+		 * Mean time allowed for calls counted, in microseconds.
+		 */
+		double
+		getMeanLimit()
+		    const;
+
+		/**
+		 * @return
+		 * Smallest amount of time, in microseconds, by which any call
+		 * beat its limit. Negative for violations. 0 if nothing has
+		 * been counted.
+		 */
+		int64_t
+		getWorstMargin()
+		    const;
+
+		/**
+		 * @brief
+		 * Convert to a single line of text.
+		 *
+		 * @return
+		 * Text that can be passed to parse().
+		 */
+		std::string
+		serialize()
+		    const;
+
+		/**
+		 * @brief
+		 * Convert the output of serialize() back to a tally.
+		 *
+		 * @param line
+		 * Output of serialize().
+		 *
+		 * @return
+		 * Tally represented by `line`.
+		 *
+		 * @throw std::runtime_error
+		 * `line` is malformed.
+		 */
+		static TimeLimitTally
+		parse(
+		    const std::string &line);
+
+	private:
+		/** Number of calls counted. */
+		uint64_t count{};
+		/** Number of calls that took longer than their limit. */
+		uint64_t violations{};
+		/** Sum of the time taken by all calls. */
+		uint64_t sum{};
+		/** Sum of the time allowed for all calls. */
+		uint64_t limitSum{};
+		/** Smallest limit minus time taken. */
+		int64_t worstMargin{};
+	};
+
+	/** Events counted by PerformanceCounters. */
+	enum class PerformanceEvent
+	{
+		Cycles,
+		Instructions,
+		CacheMisses,
+		BranchMisses,
+		PageFaults
+	};
+
+	/** Number of members of PerformanceEvent. */
+	inline constexpr std::size_t PerformanceEventCount{5};
+
+	/** Count of each PerformanceEvent, if it could be counted. */
+	using PerformanceEventCounts = std::array<std::optional<uint64_t>,
+	    PerformanceEventCount>;
+
+	/** Log header for the columns produced by formatPerformanceEvents(). */
+	inline constexpr char PerformanceEventHeader[]{"cycles,instructions,"
+	    "llc_misses,branch_misses,page_faults"};
+
+	/**
+	 * @brief
+	 * Make log-able columns of events counted during a call.
+	 *
+	 * @param counts
+	 * Events counted during the call.
+	 *
+	 * @return
+	 * Comma-separated counts, as described by PerformanceEventHeader,
+	 * with NA for events that could not be counted.
+	 */
+	std::string
+	formatPerformanceEvents(
+	    const PerformanceEventCounts &counts);
+
+	/**
+	 * @brief
+	 * Sum of events counted during many calls.
+	 */
+	class PerformanceEventTally
+	{
+	public:
+		/**
+		 * @brief
+		 * Count one call.
+		 *
+		 * @param counts
+		 * Events counted during the call.
+		 */
+		void
+		record(
+		    const PerformanceEventCounts &counts);
+
+		/**
+		 * @brief
+		 * Add all calls counted by another tally.
+		 *
+		 * @param other
+		 * Tally to add to this one.
+		 */
+		void
+		merge(
+		    const PerformanceEventTally &other);
+
+		/**
+		 * @return
+		 * Number of calls counted.
+		 */
+		uint64_t
+		getCount()
+		    const;
+
+		/**
+		 * @brief
+		 * Obtain the total of one event.
+		 *
+		 * @param event
+		 * Event to obtain.
+		 *
+		 * @return
+		 * Total of `event` over all calls, or no value if `event`
+		 * could not be counted for every call.
+		 */
+		std::optional<uint64_t>
+		getSum(
+		    const PerformanceEvent event)
+		    const;
+
+		/**
+		 * @brief
+		 * Convert to a single line of text.
+		 *
+		 * @return
+		 * Text that can be passed to parse().
+		 */
+		std::string
+		serialize()
+		    const;
+
+		/**
+		 * @brief
+		 * Convert the output of serialize() back to a tally.
+		 *
+		 * @param line
+		 * Output of serialize().
+		 *
+		 * @return
+		 * Tally represented by `line`.
+		 *
+		 * @throw std::runtime_error
+		 * `line` is malformed.
+		 */
+		static PerformanceEventTally
+		parse(
+		    const std::string &line);
+
+	private:
+		/** Number of calls counted. */
+		uint64_t count{};
+		/** Total of each event. */
+		std::array<uint64_t, PerformanceEventCount> sums{};
+		/** Number of calls during which each event was counted. */
+		std::array<uint64_t, PerformanceEventCount> counted{};
+	};
+
+	/**
+	 * @brief
+	 * Resources used by this process at one point in time.
+	 *
+	 * @details
+	 * All values are for the whole process, so when multiple threads
+	 * make calls at once, the difference between two samples includes
+	 * resources used by every call in progress.
+	 */
+	struct ResourceUsage
+	{
+		/** Processor time used by all threads, in microseconds. */
+		uint64_t cpuTime{};
+		/** Number of threads in the process. */
+		uint64_t threads{};
+		/** Bytes fetched from storage, if known. */
+		std::optional<uint64_t> readBytes{};
+		/** Bytes sent to storage, if known. */
+		std::optional<uint64_t> writtenBytes{};
+		/** Resident set size, in KiB. */
+		uint64_t residentSetSize{};
+
+		/**
+		 * @brief
+		 * Sample the resources used by this process.
+		 *
+		 * @param beforeCall
+		 * Whether the sample is taken before the call being measured
+		 * rather than after it. Processor time is read as close to
+		 * the call as possible, so the cost of sampling is not
+		 * attributed to the call.
+		 *
+		 * @return
+		 * Current resource usage.
+		 *
+		 * @throw std::runtime_error
+		 * Error obtaining processor time or resident set size.
+		 */
+		static ResourceUsage
+		sample(
+		    const bool beforeCall);
+	};
+
+	/** Log header for the columns produced by formatResourceUsage(). */
+	inline constexpr char ResourceUsageHeader[]{"cpu_time,threads_after,"
+	    "read_bytes,written_bytes,rss_delta"};
+
+	/**
+	 * @brief
+	 * Make log-able columns describing resources used by a call.
+	 *
+	 * @param before
+	 * Resource usage sampled immediately before the call.
+	 * @param after
+	 * Resource usage sampled immediately after the call.
+	 *
+	 * @return
+	 * Comma-separated processor time used (microseconds), threads in
+	 * the process after the call, bytes read from and written to storage,
+	 * and change in resident set size (KiB), as described by
+	 * ResourceUsageHeader.
+	 */
+	std::string
+	formatResourceUsage(
+	    const ResourceUsage &before,
+	    const ResourceUsage &after);
+
+	/**
+	 * @brief
+	 * Latency histograms for every kind of call made by a worker.
+	 *
+	 * @details
+	 * Each worker records its own calls without synchronization and
+	 * writes its histograms to disk when finished. The histograms from
+	 * every worker are merged once all workers have exited.
+	 */
+	class LatencyRecorder
+	{
+	public:
+		/**
+		 * @brief
+		 * Count one call.
+		 *
+		 * @param operation
+		 * Name of the call, including any parameters that it should
+		 * be grouped by (e.g., "search max_candidates=100"). Must not
+		 * contain tabs or newlines.
+		 * @param elapsed
+		 * Time taken by the call.
+		 * @param limit
+		 * Time the call was allowed to take, if elft.h limits it.
+		 */
+		void
+		record(
+		    const std::string &operation,
+		    const std::chrono::steady_clock::duration elapsed,
+		    const std::optional<std::chrono::milliseconds> &limit =
+		        std::nullopt);
+
+		/**
+		 * @brief
+		 * Count events that occurred during one call.
+		 *
+		 * @param operation
+		 * Name of the call, as passed to record().
+		 * @param counts
+		 * Events counted during the call.
+		 */
+		void
+		recordEvents(
+		    const std::string &operation,
+		    const PerformanceEventCounts &counts);
+
+		/**
+		 * @brief
+		 * Add all calls counted by another recorder.
+		 *
+		 * @param other
+		 * Recorder to add to this one.
+		 */
+		void
+		merge(
+		    const LatencyRecorder &other);
+
+		/**
+		 * @brief
+		 * Write all histograms to a file.
+		 *
+		 * @param path
+		 * File to create.
+		 *
+		 * @throw std::runtime_error
+		 * Error writing `path`.
+		 */
+		void
+		write(
+		    const std::filesystem::path &path)
+		    const;
+
+		/**
+		 * @brief
+		 * Read histograms written by write().
+		 *
+		 * @param path
+		 * File created by write().
+		 *
+		 * @return
+		 * Recorder containing the histograms from `path`.
+		 *
+		 * @throw std::runtime_error
+		 * Error reading or parsing `path`.
+		 */
+		static LatencyRecorder
+		read(
+		    const std::filesystem::path &path);
+
+		/**
+		 * @brief
+		 * Make a log-able summary of all histograms.
+		 *
+		 * @param wallTime
+		 * Wall-clock time taken by all workers to make the calls
+		 * recorded, used to compute throughput.
+		 *
+		 * @return
+		 * CSV with a header and one line per operation.
+		 */
+		std::string
+		summarize(
+		    const std::chrono::steady_clock::duration wallTime)
+		    const;
+
+		/**
+		 * @brief
+		 * Make a log-able summary of calls that have time limits.
+		 *
+		 * @return
+		 * CSV with a header and one line per operation with a time
+		 * limit. Times are in microseconds.
+		 */
+		std::string
+		summarizeTimeLimits()
+		    const;
+
+		/**
+		 * @brief
+		 * Make a log-able summary of events counted during calls.
+		 *
+		 * @return
+		 * CSV with a header and one line per operation with counted
+		 * events. Totals are followed by instructions per cycle and
+		 * misses per thousand instructions.
+		 */
+		std::string
+		summarizeEvents()
+		    const;
+
+		/**
+		 * @brief
+		 * Obtain the histogram for a single operation.
+		 *
+		 * @param operation
+		 * Name of the call, as passed to record().
+		 *
+		 * @return
+		 * Histogram for `operation`, which is empty if `operation`
+		 * was never recorded.
+		 */
+		LatencyHistogram
+		getHistogram(
+		    const std::string &operation)
+		    const;
+
+		/**
+		 * @return
+		 * Total number of calls that took longer than their limit.
+		 */
+		uint64_t
+		getTimeLimitViolations()
+		    const;
+
+	private:
+		/** Histogram for each operation. */
+		std::map<std::string, LatencyHistogram> histograms{};
+		/** Time limit comparison for each operation with a limit. */
+		std::map<std::string, TimeLimitTally> timeLimits{};
+		/** Events counted for each operation, when requested. */
+		std::map<std::string, PerformanceEventTally> events{};
+	};
+}
+
+#endif /* ELFT_VALIDATION_STATS_H_ */
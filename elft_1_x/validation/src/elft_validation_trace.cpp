@@ -0,0 +1,216 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <sys/syscall.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include <elft_validation_trace.h>
+
+namespace
+{
+	/** Whether spans are being recorded. */
+	std::atomic<bool> tracingEnabled{false};
+
+	/** One span, as recorded. */
+	struct Span
+	{
+		std::string name{};
+		std::string category{};
+		std::string detail{};
+		std::chrono::steady_clock::time_point start{};
+		std::chrono::steady_clock::time_point stop{};
+		/** Process that recorded the span (buffers survive fork()). */
+		pid_t pid{};
+	};
+
+	/** Spans recorded by the calling thread and not yet written. */
+	thread_local std::vector<Span> threadSpans{};
+
+	/**
+	 * @return
+	 * `s`, escaped for use in a JSON string.
+	 */
+	std::string
+	escape(
+	    const std::string &s)
+	{
+		std::string escaped{};
+		escaped.reserve(s.size());
+		for (const auto &c : s) {
+			switch (c) {
+			case '"':
+				escaped += "\\\"";
+				break;
+			case '\\':
+				escaped += "\\\\";
+				break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					char hex[7]{};
+					std::snprintf(hex, sizeof(hex), "\\u%04x",
+					    static_cast<unsigned int>(c));
+					escaped += hex;
+				} else {
+					escaped += c;
+				}
+			}
+		}
+		return (escaped);
+	}
+
+	/**
+	 * @return
+	 * `d` in microseconds, as trace timestamps are. Timestamps are
+	 * measured from the steady clock's epoch, which all processes share.
+	 */
+	std::string
+	microseconds(
+	    const std::chrono::steady_clock::duration &d)
+	{
+		std::stringstream ss{};
+		ss << std::fixed << std::setprecision(3) << std::chrono::
+		    duration_cast<std::chrono::duration<double, std::micro>>(
+		    d).count();
+		return (ss.str());
+	}
+}
+
+void
+ELFT::Validation::enableTracing()
+{
+	tracingEnabled = true;
+}
+
+bool
+ELFT::Validation::isTracingEnabled()
+{
+	return (tracingEnabled);
+}
+
+void
+ELFT::Validation::recordTraceSpan(
+    const std::string &name,
+    const std::string &category,
+    const std::chrono::steady_clock::time_point &start,
+    const std::chrono::steady_clock::time_point &stop,
+    const std::string &detail)
+{
+	if (!tracingEnabled)
+		return;
+
+	threadSpans.push_back({name, category, detail, start, stop,
+	    ::getpid()});
+}
+
+void
+ELFT::Validation::writeTraceSpans(
+    const std::filesystem::path &path,
+    const std::string &threadName)
+{
+	if (!tracingEnabled)
+		return;
+
+	std::ofstream file{path, std::ios_base::out | std::ios_base::trunc};
+	if (!file)
+		throw std::runtime_error{"Could not open " + path.string()};
+
+	const auto pid = ::getpid();
+	const auto tid = static_cast<pid_t>(::syscall(SYS_gettid));
+	const std::string ids{"\"pid\":" + std::to_string(pid) + ",\"tid\":" +
+	    std::to_string(tid)};
+
+	/* One JSON object per line */
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\"," << ids <<
+	    ",\"args\":{\"name\":\"" << escape(threadName) << "\"}}\n";
+	for (const auto &span : threadSpans) {
+		/* Spans from before fork() belong to the parent */
+		if (span.pid != pid)
+			continue;
+
+		file << "{\"name\":\"" << escape(span.name) << "\",\"cat\":\"" <<
+		    escape(span.category) << "\",\"ph\":\"X\",\"ts\":" <<
+		    microseconds(span.start.time_since_epoch()) <<
+		    ",\"dur\":" << microseconds(span.stop - span.start) <<
+		    ',' << ids;
+		if (!span.detail.empty())
+			file << ",\"args\":{\"detail\":\"" <<
+			    escape(span.detail) << "\"}";
+		file << "}\n";
+	}
+	threadSpans.clear();
+
+	file.close();
+	if (!file)
+		throw std::runtime_error{"Could not write " + path.string()};
+}
+
+void
+ELFT::Validation::mergeTraceFiles(
+    const std::vector<std::filesystem::path> &parts,
+    const std::filesystem::path &output)
+{
+	std::ofstream file{output, std::ios_base::out | std::ios_base::trunc};
+	if (!file)
+		throw std::runtime_error{"Could not open " + output.string()};
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first{true};
+	for (const auto &part : parts) {
+		std::ifstream in{part};
+		if (!in)
+			throw std::runtime_error{"Could not open " +
+			    part.string()};
+
+		std::string line{};
+		while (std::getline(in, line)) {
+			if (line.empty())
+				continue;
+			if (!first)
+				file << ",\n";
+			file << line;
+			first = false;
+		}
+		if (in.bad())
+			throw std::runtime_error{"Could not read " +
+			    part.string()};
+	}
+	file << "\n]}\n";
+
+	file.close();
+	if (!file)
+		throw std::runtime_error{"Could not write " + output.string()};
+}
+
+ELFT::Validation::TraceSpan::TraceSpan(
+    std::string name,
+    std::string category,
+    std::string detail) :
+    name{std::move(name)},
+    category{std::move(category)},
+    detail{std::move(detail)},
+    start{std::chrono::steady_clock::now()}
+{
+
+}
+
+ELFT::Validation::TraceSpan::~TraceSpan()
+{
+	recordTraceSpan(this->name, this->category, this->start,
+	    std::chrono::steady_clock::now(), this->detail);
+}
@@ -0,0 +1,147 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef ELFT_VALIDATION_TRACE_H_
+#define ELFT_VALIDATION_TRACE_H_
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace ELFT::Validation
+{
+	/**
+	 * @brief
+	 * Start recording trace spans in this process.
+	 *
+	 * @details
+	 * Spans are buffered per thread until writeTraceSpans() is called
+	 * from that thread. Recording is inherited across fork().
+	 */
+	void
+	enableTracing();
+
+	/**
+	 * @return
+	 * Whether enableTracing() has been called.
+	 */
+	bool
+	isTracingEnabled();
+
+	/**
+	 * @brief
+	 * Record a span of time on the calling thread.
+	 *
+	 * @param name
+	 * Name of the activity (e.g., "search").
+	 * @param category
+	 * Kind of activity (e.g., "api", "io", "process").
+	 * @param start
+	 * Time the activity started.
+	 * @param stop
+	 * Time the activity stopped.
+	 * @param detail
+	 * Optional description shown with the span (e.g., an identifier).
+	 *
+	 * @note
+	 * Does nothing unless tracing is enabled.
+	 */
+	void
+	recordTraceSpan(
+	    const std::string &name,
+	    const std::string &category,
+	    const std::chrono::steady_clock::time_point &start,
+	    const std::chrono::steady_clock::time_point &stop,
+	    const std::string &detail = "");
+
+	/**
+	 * @brief
+	 * Write spans recorded by the calling thread in this process.
+	 *
+	 * @param path
+	 * File to create, which can be passed to mergeTraceFiles().
+	 * @param threadName
+	 * Name shown for the calling thread in the timeline.
+	 *
+	 * @throw std::runtime_error
+	 * Error writing `path`.
+	 *
+	 * @note
+	 * Recorded spans are discarded once written. Does nothing unless
+	 * tracing is enabled.
+	 */
+	void
+	writeTraceSpans(
+	    const std::filesystem::path &path,
+	    const std::string &threadName);
+
+	/**
+	 * @brief
+	 * Combine files from writeTraceSpans() into one trace.
+	 *
+	 * @param parts
+	 * Files written by writeTraceSpans().
+	 * @param output
+	 * Trace to create, in Chrome trace-event JSON format, viewable in
+	 * Perfetto or chrome://tracing.
+	 *
+	 * @throw std::runtime_error
+	 * Error reading `parts` or writing `output`.
+	 */
+	void
+	mergeTraceFiles(
+	    const std::vector<std::filesystem::path> &parts,
+	    const std::filesystem::path &output);
+
+	/**
+	 * @brief
+	 * Span of time covering the lifetime of this object.
+	 */
+	class TraceSpan
+	{
+	public:
+		/**
+		 * @brief
+		 * TraceSpan constructor, starting the span.
+		 *
+		 * @param name
+		 * Name of the activity.
+		 * @param category
+		 * Kind of activity.
+		 * @param detail
+		 * Optional description shown with the span.
+		 */
+		TraceSpan(
+		    std::string name,
+		    std::string category,
+		    std::string detail = "");
+
+		/** Stop the span and record it. */
+		~TraceSpan();
+
+		/** @cond SUPPRESS_FROM_DOXYGEN */
+		TraceSpan(const TraceSpan&) = delete;
+		TraceSpan& operator=(const TraceSpan&) = delete;
+		/** @endcond */
+
+	private:
+		/** Name of the activity. */
+		const std::string name;
+		/** Kind of activity. */
+		const std::string category;
+		/** Description shown with the span. */
+		const std::string detail;
+		/** Time the span started. */
+		const std::chrono::steady_clock::time_point start;
+	};
+}
+
+#endif /* ELFT_VALIDATION_TRACE_H_ */
@@ -0,0 +1,129 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <elft_validation_log.h>
+
+namespace
+{
+	/** Number of failed checks. */
+	unsigned int failures{};
+
+	/**
+	 * @brief
+	 * Record the outcome of a check.
+	 *
+	 * @param passed
+	 * Whether the check passed.
+	 * @param description
+	 * What was checked.
+	 */
+	void
+	check(
+	    const bool passed,
+	    const char *description)
+	{
+		if (!passed) {
+			std::cerr << "FAIL: " << description << '\n';
+			++failures;
+		}
+	}
+
+	/**
+	 * @return
+	 * Contents of the file at `path`.
+	 */
+	std::string
+	readFile(
+	    const std::filesystem::path &path)
+	{
+		std::ifstream file{path, std::ios_base::binary};
+		return {std::istreambuf_iterator<char>(file),
+		    std::istreambuf_iterator<char>()};
+	}
+}
+
+int
+main()
+{
+	const auto directory = std::filesystem::temp_directory_path() /
+	    ("test_log-" + std::to_string(::getpid()));
+	std::filesystem::create_directories(directory);
+	const auto path = directory / "log";
+
+	/*
+	 * Many rows through the smallest buffer, so that buffers are handed
+	 * to the background thread many times and values straddle them.
+	 */
+	std::ostringstream expected{};
+	expected << std::fixed << std::setprecision(6);
+	const std::string longText(10000, 'x');
+	try {
+		ELFT::Validation::LogWriter log{path, 0};
+		for (int i{}; i < 20000; ++i) {
+			const double similarity{i / 7.0};
+			const int64_t negative{-i};
+			log << "row," << i << ',' << negative << ',' <<
+			    similarity << ',' << (i % 2 == 0) << '\n';
+			expected << "row," << i << ',' << negative << ',' <<
+			    similarity << ',' << (i % 2 == 0 ? '1' : '0') <<
+			    '\n';
+		}
+		log << std::numeric_limits<uint64_t>::max() << ',' <<
+		    std::numeric_limits<int64_t>::min() << ',' <<
+		    -std::numeric_limits<double>::max() << '\n';
+		expected << std::numeric_limits<uint64_t>::max() << ',' <<
+		    std::numeric_limits<int64_t>::min() << ',' <<
+		    -std::numeric_limits<double>::max() << '\n';
+		log << longText << '\n';
+		expected << longText << '\n';
+		log.close();
+
+		check(readFile(path) == expected.str(),
+		    "file contains every value, in order");
+	} catch (const std::exception &e) {
+		std::cerr << "FAIL: writing: " << e.what() << '\n';
+		++failures;
+	}
+
+	/* Destruction without close() still writes everything */
+	{
+		ELFT::Validation::LogWriter log{path};
+		log << "unclosed\n";
+	}
+	check(readFile(path) == "unclosed\n", "destructor flushes");
+
+	bool threw{false};
+	try {
+		ELFT::Validation::LogWriter log{directory / "missing" / "log"};
+	} catch (const std::runtime_error&) {
+		threw = true;
+	}
+	check(threw, "constructor throws when the file cannot be opened");
+
+	std::filesystem::remove_all(directory);
+
+	if (failures != 0)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}
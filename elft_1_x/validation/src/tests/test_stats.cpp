@@ -0,0 +1,120 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <elft_validation_stats.h>
+
+namespace
+{
+	/** Number of failed checks. */
+	unsigned int failures{};
+
+	/**
+	 * @brief
+	 * Record the outcome of a check.
+	 *
+	 * @param passed
+	 * Whether the check passed.
+	 * @param description
+	 * What was checked.
+	 */
+	void
+	check(
+	    const bool passed,
+	    const char *description)
+	{
+		if (!passed) {
+			std::cerr << "FAIL: " << description << '\n';
+			++failures;
+		}
+	}
+
+	/**
+	 * @return
+	 * Whether LatencyHistogram::parse() of `line` throws
+	 * std::runtime_error.
+	 */
+	bool
+	rejects(
+	    const std::string &line)
+	{
+		try {
+			ELFT::Validation::LatencyHistogram::parse(line);
+		} catch (const std::runtime_error&) {
+			return (true);
+		}
+		return (false);
+	}
+}
+
+int
+main()
+{
+	using ELFT::Validation::LatencyHistogram;
+
+	LatencyHistogram empty{};
+	check((empty.getCount() == 0) && (empty.getPercentile(50) == 0) &&
+	    (empty.getMean() == 0), "empty histogram reports zeros");
+
+	/* Small values are counted exactly */
+	LatencyHistogram small{};
+	for (uint64_t i{1}; i <= 100; ++i)
+		small.record(i);
+	check(small.getPercentile(50) == 50, "exact median of small values");
+	check(small.getPercentile(99) == 99, "exact p99 of small values");
+	check(small.getPercentile(0) == 1, "p0 is the minimum");
+
+	/* Large values are within one sub-bucket (1/64) above the truth */
+	LatencyHistogram large{};
+	for (uint64_t i{1}; i <= 1000000; ++i)
+		large.record(i);
+	check(large.getCount() == 1000000, "getCount() counts every record");
+	check(large.getMean() == 500000.5, "getMean() is exact");
+	check(large.getMaximum() == 1000000, "getMaximum() is exact");
+	const auto p50 = large.getPercentile(50);
+	check((p50 >= 500000) && (p50 <= 500000 + (500000 / 64)),
+	    "median is within relative error");
+	check(large.getPercentile(100) == 1000000, "p100 is the maximum");
+
+	/* Merging matches recording everything in one histogram */
+	LatencyHistogram both{small};
+	both.merge(large);
+	LatencyHistogram direct{large};
+	for (uint64_t i{1}; i <= 100; ++i)
+		direct.record(i);
+	check(both.serialize() == direct.serialize(),
+	    "merge() matches recording directly");
+
+	/* Round trip through the latency log format */
+	try {
+		check(LatencyHistogram::parse(both.serialize()).serialize() ==
+		    both.serialize(), "parse() inverts serialize()");
+		check(LatencyHistogram::parse(empty.serialize()).getCount() ==
+		    0, "parse() of an empty histogram");
+	} catch (const std::exception &e) {
+		std::cerr << "FAIL: round trip: " << e.what() << '\n';
+		++failures;
+	}
+
+	check(rejects(""), "rejects an empty line");
+	check(rejects("1 1"), "rejects a missing maximum");
+	check(rejects("1 1 1 1"), "rejects a bucket without a count");
+	check(rejects("1 1 1 x:1"), "rejects a non-numeric bucket");
+	check(rejects("1 1 1 99999999:1"), "rejects an unknown bucket");
+	check(rejects("2 1 1 1:1"), "rejects counts that do not add up");
+
+	if (failures != 0)
+		return (EXIT_FAILURE);
+	return (EXIT_SUCCESS);
+}